@@ -0,0 +1,34 @@
+
+/*
+*******************************************
+* File Name     : errLog.h                *
+* Author		: Sandesh Sharma.         *
+*******************************************
+*/
+// Layout of one log.bin record. The log file is a plain array of these,
+// written by displayMessage() in linkedList_v2.c and read back by readLog(),
+// netLog() and the logDump tool. Don't reorder the fields, old logs would stop reading.
+
+#ifndef ERRLOG_H
+#define ERRLOG_H
+
+#include <stdbool.h>
+
+typedef struct errorStruct{
+
+	int errYear;
+	int errMonth;
+	int errDoM;
+	int errDoW;
+	int errToD;
+	int errM;
+	int errS;
+	bool valAssocFlag;
+	int valueAssoc;
+	char errMessage[256];
+	char errTimeZone[4];
+	
+
+}errStruct;
+
+#endif
@@ -29,7 +29,8 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
-#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
 #endif
 
 //Define Pre-processor macros for portability.
@@ -37,13 +38,28 @@
 #define ISVALIDSOCKET(s) ((s) != INVALID_SOCKET)
 #define CLOSESOCKET(s) closesocket(s)
 #define GETSOCKETERRNO() (WSAGetLastError())
+#define NETPOLL(fds,n,ms) WSAPoll(fds,n,ms)
+#define NET_WOULDBLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define NET_SEND_FLAGS 0
+#define THREAD_LOCAL __declspec(thread)
+#define GMTIME(t,tmBuf) (gmtime_s(tmBuf,t) == 0 ? (tmBuf) : NULL)
 
 #else // Macors for UNIX
 
 #define ISVALIDSOCKET(s) ((s) >= 0)
 #define CLOSESOCKET(s) close(s)
 #define SOCKET int
+#define INVALID_SOCKET (-1)
 #define GETSOCKETERRNO() (errno)
+#define NETPOLL(fds,n,ms) poll(fds,n,ms)
+#define NET_WOULDBLOCK() (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+#define THREAD_LOCAL __thread
+#define GMTIME(t,tmBuf) gmtime_r(t,tmBuf)
+#if defined(MSG_NOSIGNAL)
+#define NET_SEND_FLAGS MSG_NOSIGNAL // a client that hung up is an error from send, not a SIGPIPE
+#else
+#define NET_SEND_FLAGS 0
+#endif
 
 #endif
 
@@ -53,781 +69,5031 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <time.h>
+#include <limits.h>
+#include <errno.h>
+#include "errLog.h" // errStruct, the log.bin record (shared with logDump.c)
+#include <stddef.h>
+
+#if !defined(_WIN32)
+#include <pthread.h> // aggregation worker threads
+#include <sys/uio.h>
+#else
+#include <io.h> // _read/_write/_lseeki64 for the synchronous I/O backend
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h> // io_uring through its syscalls, liburing isn't needed
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#define AIO_HAVE_URING
+#ifndef IORING_FEAT_RW_CUR_POS
+#define IORING_FEAT_RW_CUR_POS (1U << 3) // headers older than the kernel (5.6) that has it
+#endif
+#endif
+#endif
+
+
+// Output verbosity levels. Set from the command line (-q, -v).
+// Anything printed once per record must be VERB_VERBOSE so bulk operations stay silent by default.
+#define VERB_QUIET 0 // errors and interactive prompts only
+#define VERB_NORMAL 1 // messages and summaries (default)
+#define VERB_VERBOSE 2 // per-record output (load, insert, write, send)
+
+#define VPRINTF(level, ...) do{ if(verbosity >= (level)) printf(__VA_ARGS__); }while(0)
+
+
+
+// Trace points (build with -DEMP_TRACE, export with -trace file).
+// TRACE_BEGIN/TRACE_END bracket a span of work on the calling thread and must pair up on
+// every path out. Each thread records into its own buffer, so tracing takes no locks after
+// a thread's first span. Without EMP_TRACE they expand to nothing.
+#if defined(EMP_TRACE)
+#define TRACE_BEGIN(name) traceBegin(name)
+#define TRACE_END() traceEnd()
+static void traceBegin(const char * name); // name must be a string literal (kept by pointer)
+static void traceEnd();
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+#endif
+
 
 
 
 
 
+// Person schema. One line per stored field, in on-disk order :
+// NUM(name,type,label) for numbers, TEXT(name,size,label) for fixed size text.
+// struct Person and all the per-field code (copy, compare, print, CSV/JSON in and out,
+// field lookup by name) are expanded from this list, so a new field is a new line here.
+// The disk record (PERSON_DISK_SIZE) grows with it, older data files won't load after that.
+#define PERSON_FIELDS(NUM,TEXT) \
+	NUM(id,int,"Emp. ID:") \
+	TEXT(fName,30,"First Name:") \
+	TEXT(lName,40,"Last Name:") \
+	NUM(age,int,"Age:") \
+	TEXT(emailAddress,50,"E-Mail:") \
+	NUM(phone,unsigned long int,"Phone :")
 
+#define PERSON_DECL_NUM(name,type,label) type name;
+#define PERSON_FITS(type,v) ((long long)(type)(v) == (v) && ((v) >= 0 || !((type)-1 > 0))) // v survives being stored in a field of type
+#define PERSON_DECL_TEXT(name,size,label) char name[size];
+#define PERSON_ENUM(name,...) PF_##name,
+#define PERSON_NAME(name,...) #name,
+#define PERSON_IS_NUM(name,...) 1,
+#define PERSON_IS_TEXT(name,...) 0,
+
+enum personFieldEnum{ PERSON_FIELDS(PERSON_ENUM,PERSON_ENUM) PF_COUNT }; // PF_id, PF_fName, ...
+
+static const char * const personFieldNames[PF_COUNT] = { PERSON_FIELDS(PERSON_NAME,PERSON_NAME) };
+static const char personFieldIsNum[PF_COUNT] = { PERSON_FIELDS(PERSON_IS_NUM,PERSON_IS_TEXT) };
 
 struct Person{ //Person structure..
 
-	int id;
-	char fName[30];
-	char lName[40];
-	int  age;
-	char emailAddress[50];
-	unsigned long int phone;
+	PERSON_FIELDS(PERSON_DECL_NUM,PERSON_DECL_TEXT)
 		
 	struct Person * next;
+
+	// In-memory bookkeeping only. Nothing after next is ever written to disk (see PERSON_DISK_SIZE).
+	unsigned int bornEpoch; // store epoch the node was inserted in
+	unsigned int diedEpoch; // store epoch it was deleted in, 0 while live
 };
 
+// On-disk record size : the struct as it was before the bookkeeping fields were added,
+// so existing data files keep loading.
+#define PERSON_DISK_SIZE (offsetof(struct Person,next) + sizeof(struct Person *))
 
 
-typedef struct errorStruct{
 
-	int errYear;
-	int errMonth;
-	int errDoM;
-	int errDoW;
-	int errToD;
-	int errM;
-	int errS;
-	bool valAssocFlag;
-	int valueAssoc;
-	char errMessage[256];
-	char errTimeZone[4];
-	
+// Ordered id index over the employee list (skip list).
+// Every list node has exactly one index entry, which also remembers the node's
+// list predecessor so deletes don't need a walk from the head.
+#define IDX_MAX_LEVEL 24
 
-}errStruct;
+#define IDX_CACHED 1 // rec points into the lazy record cache
+#define IDX_DIRTY 2 // record is new or changed since the last save
 
+// The data file is an array of PERSON_DISK_SIZE records, so a record's slot number is its address.
+// A deleted record's slot is overwritten with a tombstone (this id, everything else zero) and
+// can be handed to a later insert; loaders skip tombstones.
+#define TOMBSTONE_ID INT_MIN
 
+#define SEARCH_UNSAVED (-3) // searchList on a lazy store : found, but it has no slot in the file until it's saved
 
-static clock_t begin,end;
+// Blocked Bloom filter in front of the index. Every id sets BLOOM_PROBES bits inside one
+// 512 bit block (one cache line), so a miss costs one hash and one line instead of a
+// skip list descent. Deletes can't clear bits : they are counted and the filter is
+// rebuilt from the index once they pile up, or when it outgrows BLOOM_BITS_PER_KEY.
+#define BLOOM_BLOCK_WORDS 8
+#define BLOOM_PROBES 4
+#define BLOOM_BITS_PER_KEY 16 // about 0.2% false positives at full load
+#define BLOOM_MIN_BLOCKS 64
 
-static errStruct sessionErrorInit;
+struct freeSlot{
 
-static FILE * logFile = NULL;
+	long slot;
+	bool punched; // tombstone already on disk
 
-static int changesMade = 0,fileOverwrittenFlag= 0;
+};
 
-static int totalNodes;
+struct idxNode{
 
+	int id;
+	struct Person * rec; // the list node holding this id (lazy store : cached or unsaved copy, NULL if on disk only)
+	struct Person * prev; // rec's predecessor in the list, NULL if rec is the head
+	long slot; // record number in the data file, -1 if not on disk yet (lazy store)
+	unsigned char flags; // IDX_*
+	int level;
+	struct idxNode * fwd[]; // forward pointers, one per level
+};
 
-int recursiveSearch(struct  Person ** hNode, int nodeCount,int searchVal);
+typedef struct indexStruct{
 
-void throwError(int errorCode , int lineNo); //Prints an error message and line number.
+	struct idxNode * header;
+	int level;
+	int count;
+	unsigned int seed;
+	struct Person * tail; // last node of the list, for O(1) appends
+	struct lazyStruct * lazy; // set when records live in the data file instead of the list
 
-void displayMessage(int msgCode,int val); //Prints appropriate message according to predefined message code.
+	long slotCount; // slots in the data file, live or not
+	struct freeSlot * freeSlots; // slots a new record can go to
+	int freeCount,freeCap;
+	int * dirtyIds; // ids marked IDX_DIRTY since the last save (may include deleted ones)
+	int dirtyCount,dirtyCap;
 
-int insertNode(struct Person ** headNode , struct Person newNode); // inserts node and returns 0 (can be used later for error codes)
+	unsigned long long * bloom; // BLOOM_BLOCK_WORDS words per block, NULL means "maybe" for every id
+	unsigned long bloomBlocks; // power of two
+	int bloomKeys; // ids added since the last rebuild
+	int bloomStale; // ids removed since the last rebuild, their bits are still set
+	long bloomSkips; // lookups the filter answered on its own
+	bool bloomFailed; // its allocation failed : off (lookups go to the index) until an explicit bloomRebuild succeeds
 
-int printList(struct Person * headNode, int printList); // Returns the total number of items
+}idxStruct;
 
-int searchList(struct Person * headN, int searchVal, int searchFlag); //searches the list for a value. If found, returns the position (starting from 1), else 0; (Linear Search, O(n) = n);
+typedef struct indexCursor{ // Range cursor, hands out records in id order
 
-int deleteNode (struct Person ** firstNode, int delVal); // deletes a list and returns 1 if sucessfully deletes, 0 if not found;
+	idxStruct * idx;
+	struct idxNode * node; // next entry to return
+	int hiId; // inclusive upper bound
 
-struct Person * deleteList(struct Person ** entryNode); // deletes the entire list except for the head. Set's head to NULL;
+}idxCursor;
 
-void printInfo(struct Person Node); //  Prints a node information
 
-int overwriteFile(struct Person ** newHead, char fileName[20]); // Overwrites the files with new information
- 
-static bool self_init(); //Initializes log file and errStruct, returns false on failure
 
-int netLog(); // Reads the log and passes it over a tcp network. (Currently set to localhost:8080);
+// Aggregation engine. Groups rows by nothing, age band or e-mail domain and computes
+// count/sum/min/max/avg of one numeric field.
+#define AGG_MAX_GROUPS 256 // domains past this many fold into the last group
+#define AGG_PARALLEL_MIN 65536 // rows before the scan is split across threads
+#define AGG_MAX_THREADS 16
 
-void readLog(); // Reads the log and prints the log on the standard console screen (calls printErrLog() function)
+#define AGG_GROUP_NONE 0
+#define AGG_GROUP_AGE 1
+#define AGG_GROUP_DOMAIN 2
 
-void printErrLog(errStruct a); // Reades the errStruct structure and prints the inforamtion in a human readable manner.
+typedef struct aggregateStruct{
 
-static bool initErrorStruct(int year, int month, int dOfMonth, int dOfWeek);
+	int groupBy; // AGG_GROUP_*
+	int bandWidth; // age band width for AGG_GROUP_AGE
+	int field; // PF_* of a numeric field
 
-SOCKET InitializeSocket();
+	int groupCount;
+	char keys[AGG_MAX_GROUPS][50];
+	long count[AGG_MAX_GROUPS];
+	long long sum[AGG_MAX_GROUPS];
+	long long min[AGG_MAX_GROUPS];
+	long long max[AGG_MAX_GROUPS];
 
+}aggStruct;
 
 
 
+// Streaming CSV / JSON-lines import and export.
+// Files are moved through one IO_BUF_SIZE buffer, so memory use doesn't depend on file size.
+#define IO_BUF_SIZE (1 << 20)
 
-SOCKET InitializeSocket(){
+#define FMT_CSV 0
+#define FMT_JSONL 1
 
 
-		//printf("Configuring local address...\n");
-		displayMessage(10,0);
-		struct addrinfo hints; // declar a addrinfo structure
-	 
-		memset(&hints, 0, sizeof(hints)); // Fill it will 0 values	 
-		hints.ai_family = AF_INET; // IPv4 (AF_INET6 for IPv6);
-		hints.ai_socktype = SOCK_STREAM; // for TCP connection (SOCK_DGRAM for UDP).
-		hints.ai_flags = AI_PASSIVE; // Any network interface available. Has to be set before callind getaddrinfo. 
-		struct addrinfo *bind_address; // pointer to an addrinfo struct to save the values reteurned by getaddrinfo();
 
-		getaddrinfo(0, "8080", &hints, &bind_address); // First param NULL, 2nd: Port to listen on, hints: What we're looking for
-															// bindaddress:: return buffer.
-		//printf("Creating socket...\n");
-		displayMessage(11,0);
-		SOCKET socket_listen; // Create a socket.. In Wondows, it's WINSOCK type. On UNIX enviroment , it's an unsigned int (file descriptor)
+// Point-in-time view of the list. Nodes deleted while a snapshot is held stay linked
+// (marked with diedEpoch) until the last snapshot is released, and nodes appended after
+// it are past its tail or newer than its epoch, so a snapshot reader always sees the list
+// exactly as it was, without copying it.
+typedef struct snapshotStruct{
 
-					//socket: parameters  //socket family, socket type and socket protocol
-					//returns -ve int on UNIX enviroment and INVALID_SOCKET error on Windows enviroment;
-		socket_listen = socket(bind_address->ai_family,bind_address->ai_socktype, bind_address->ai_protocol);
-		if (!ISVALIDSOCKET(socket_listen)) { // If invalid, get errorNo , WSAGetLastError() on Windows, errno on UNIX enviroment;
-				return INVALID_SOCKET;		
-		}
-		
-		//("Binding socket to local address...\n");
+	struct Person * head;
+	struct Person * tail; // walks stop here, everything after it was appended later
+	unsigned int epoch;
 
+}snapStruct;
 
-		// Binding the socket too a local address, 
-		// bind() returns 0 on success and non-zero on failure.
-		if (bind(socket_listen,bind_address->ai_addr, bind_address->ai_addrlen)) {  //  If non-zero, throw error.
-				//fprintf(stderr, "bind() failed. (%d)\n", GETSOCKETERRNO());
-				freeaddrinfo(bind_address); // Now that we've binded the socket, free the memory for addrinfo;
-				return INVALID_SOCKET;
-		}
-		freeaddrinfo(bind_address); // Now that we've binded the socket, free the memory for addrinfo;
-		//displayMessage(14,8080);
-		//printf("Listening...\n"); //
-	
-		printf("Waiting for connection...\n");
-		return socket_listen;
-}
+// Lazy store. Only the id index is built at startup; each entry remembers its record's slot
+// in the data file and full records are read in on first use, into a fixed size LRU cache.
+// Records inserted during the session aren't on disk yet, so they stay in memory until saved.
+struct cacheSlot{
 
+	struct Person rec; // first member, so a cached record's address is its slot's
+	struct idxNode * owner; // entry the record belongs to, NULL if the slot is free
+	int newer,older; // LRU neighbours, -1 at the ends
 
-void printErrLog( errStruct a){
+};
 
+typedef struct lazyStruct{
 
-	if(a.valAssocFlag){
-		printf("\n[ERR LOG] [ %d/%d/%d  %d:%d:%d ] %s %d",a.errDoM,a.errMonth,a.errYear,a.errToD,a.errM,a.errS,a.errMessage,a.valueAssoc);
-	}else{
+	FILE * file; // NULL until the first save when the data file didn't exist yet
+	struct cacheSlot * slots;
+	int capacity,used;
+	int newest,oldest;
+	long hits,faults;
 
-		printf("\n[ERR LOG] [ %d/%d/%d  %d:%d:%d ] %s",a.errDoM,a.errMonth,a.errYear,a.errToD,a.errM,a.errS,a.errMessage);
-	}
-	
+}lazyStruct;
 
 
-}
 
-static bool initErrorStruct(int year, int month, int dOfMonth, int dOfWeek){
+#define SNAP_VISIBLE(node,snapEpoch) ((node)->bornEpoch <= (snapEpoch) && ((node)->diedEpoch == 0 || (node)->diedEpoch > (snapEpoch)))
 
-	bool retFlag = false;
 
-	sessionErrorInit.errYear = year;
-	sessionErrorInit.errMonth = month;
-	sessionErrorInit.errDoM = dOfMonth;
-	sessionErrorInit.errDoW = dOfWeek;
-	sessionErrorInit.valAssocFlag = false;
 
-	strncpy(sessionErrorInit.errTimeZone,"UTC\0",4);
+// Sequential read of every live record, for saves, exports, listings and aggregation.
+// Eager store : a snapshot walk of the list. Lazy store : the data file read front to back
+// (a record counts if the index still points at its slot), then the unsaved records.
+typedef struct scanStruct{
 
-	retFlag = true;
-	return retFlag;
+	long count; // live records when the scan started
+	snapStruct * snap; // eager
+	struct Person * cur;
+	FILE * file; // lazy
+	char * buf;
+	long bufRecs,bufPos,slot;
+	struct idxNode * pending;
+	struct Person rec;
+	idxStruct * idx; // lazy : the index being read
+	int shard; // sharded : next shard to read, -1 otherwise
 
-}
+}scanStruct;
 
-void readLog(){
 
-	errStruct temp;
-	fseek(logFile,0,SEEK_SET);
-	if(logFile != NULL){
 
-		while(!feof(logFile)){
-			fread(&temp,sizeof(errStruct),1,logFile);
-			printErrLog(temp);
-		}
-	}
-}
+// Sharded store (-shards n). Employees are spread over n data files, <dataFile>.0 .. .n-1,
+// by a hash of the id. Each shard is a lazy index over its own file.
+#define SHARD_MAX 64
+#define SHARD_DEFAULT_CACHE 4096 // records cached per shard when -lazy isn't given
 
+typedef struct shardStruct{
 
-int netLog(){
+	char path[FILENAME_MAX];
+	idxStruct idx;
+	bool opened; // ids read, idx usable
+	int result; // 1 if the last parallel task succeeded on this shard
+	long written,punched; // counts from the last save or compaction
 
-	int retFlag = 0,bytes_sent,flag=0;
-	char line[256],buffer[20];
-	if(logFile == NULL){
+}shardStruct;
 
-		displayMessage(9,0);
 
-	}else{
 
+typedef struct optionStruct{ // Command line options (see parseArgs)
 
+	bool rangeFlag;
+	int rangeLo;
+	int rangeHi;
+	int rangeLimit; // -1 : no limit
+	char * aggQuery; // -agg query string, NULL if not asked for
+	char * importFile; // -import file (.csv or .jsonl), NULL if not asked for
+	char * exportFile; // -export file (.csv or .jsonl), NULL if not asked for
+	int lazyCache; // -lazy n : records kept in memory, 0 loads everything
+	bool compact; // -compact : save by rewriting the whole file instead of only the changes
+	int shards; // -shards n : sharded store over n files, 0 for a single file
+	char * traceFile; // -trace file : where the trace goes at exit (.json : Chrome trace, else folded stacks)
+	int serveSecs; // -serve secs : netLog keeps serving for this long, 0 : until the first client is served
+	int backlog; // -backlog n : accept queue length for the listening socket
+	int maxConn; // -maxconn n : connections served at once, the rest wait in the accept queue
 
-		errStruct  temp ;
+}optStruct;
 
 
-		SOCKET errSock = InitializeSocket();
 
-		if(ISVALIDSOCKET(errSock)){
 
-			displayMessage(14,8080);
 
-			if (listen(errSock, 10) < 0) { // Listen on that socket. 2nd parameter (10) is the max number that the server can queue up.
-													 // If the queue is full, any additional incoming requests are rejected until the queue is free.
-													// 
-				fprintf(stderr, "listen() failed. (%d)\n", GETSOCKETERRNO());
-				return 1;
-			}
-				//printf("Waiting for connection...\n");
 
-			struct sockaddr_storage client_address; //
-			socklen_t client_len = sizeof(client_address);
-			SOCKET socket_client = accept(errSock,(struct sockaddr*) &client_address, &client_len);
 
-			if(ISVALIDSOCKET(socket_client)){
+static clock_t begin,end;
 
-				char response[1024];
-				char header[] = "\r\nHTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\n\r\n";
+static errStruct sessionErrorInit;
 
-				displayMessage(15,8080);//Client Connected;
+// Log timestamp cache. displayMessage stamps every event, so the broken down UTC time is
+// kept here and only recomputed when the second changes (the date only when the day does).
+// One per thread : shard and pool threads log too, and would tear a shared one.
+typedef struct clockStruct{
 
-				retFlag = 1;
-				fseek(logFile,0,SEEK_SET);
+	long long second; // seconds since the epoch the fields below are for, -1 before the first read
+	long long day; // second / 86400
+	int year,month,dOfMonth,dOfWeek,hour,min,sec;
 
-				while(!feof(logFile)){
+}clockStruct;
 
-					fread(&temp,sizeof(errStruct),1,logFile);
-					//strncat(response+sizeof(header),temp.errMessage,sizeof(temp.errMessage));
-						
-					if(flag == 0){
-						strncpy(response,header,strlen(header));
-						strncat(response,temp.errMessage,sizeof(temp.errMessage));
-						flag=1;
-					}else{
+static THREAD_LOCAL clockStruct logClock = {-1,-1,0,0,0,0,0,0,0};
 
-						strncpy(response,temp.errMessage,sizeof(temp.errMessage));
 
-					}
 
-					if(temp.valAssocFlag == 1){
+// Asynchronous file I/O. A context queues positional reads and writes and completes them in
+// any order : through io_uring where the kernel has it, else a small pool of threads doing
+// pread/pwrite, else (Windows, or -aio sync) right away on the calling thread.
+// A context is used by one thread only; bulk operations open their own.
+#define AIO_SYNC 0
+#define AIO_THREADS 1
+#define AIO_URING 2
 
-						itoa(temp.valueAssoc,buffer,10);
-						strncat(response,buffer,sizeof(buffer));
-					}
+#define AIO_DEPTH 32 // requests in flight on a ring, staging buffers of a slot writer
+#define AIO_WORKERS 4 // threads of the fallback pool
+#define AIO_STREAM_BUFS 8 // chunks in flight on a sequential stream
+#define AIO_CHUNK ((262144 / PERSON_DISK_SIZE) * PERSON_DISK_SIZE) // whole records, about 256KB
+#define LOG_BATCH 64 // log records gathered before they're written
 
-					strcat(response,"\r\n");
-						//strncat(response,'\0',1);
-					bytes_sent = send(socket_client,response, strlen(response), 0);
+typedef struct aioRequest{
 
+	int fd;
+	char * buf;
+	size_t len;
+	long long offset; // -1 : at the file position (appends)
+	bool write;
+	long result; // bytes moved, -1 on error
+	bool done; // true until submitted, then once result is set
+	size_t moved; // io_uring : bytes done so far, a short transfer is resubmitted for the rest
+	struct aioRequest * next; // fallback pool queue
+#if !defined(_WIN32)
+	struct iovec iov;
+#endif
 
-					printf("\nSent %d of %d bytes.\n", bytes_sent, (int)strlen(response));
-					memset(response,0,sizeof(response));
-					memset(buffer,0,sizeof(buffer));
-						//printf("\n%s",temp->errMessage);
-						//printErrLog(temp);
-						
-				}
+}aioReq;
 
-					
-					
-				
-				printf("\nClosing connection...\n");
-				CLOSESOCKET(socket_client);
-
-				printf("\nClosing listening socket...\n");
-				CLOSESOCKET(errSock);
-				#if defined(_WIN32)
-					WSACleanup();
-				#endif
-				printf("Finished.\n");
-				retFlag = 1;
-			}else{
+typedef struct aioStruct{
 
-				displayMessage(12,GETSOCKETERRNO());
-			}
-		}
-	
+	int backend; // AIO_*
+#if defined(AIO_HAVE_URING)
+	int ringFd;
+	unsigned * sqHead,*sqTail,*sqMask,*sqArray;
+	unsigned * cqHead,*cqTail,*cqMask;
+	struct io_uring_sqe * sqes;
+	struct io_uring_cqe * cqes;
+	void * sqMap,*cqMap;
+	size_t sqMapLen,cqMapLen,sqesLen;
+	unsigned entries,inFlight,unsubmitted;
+#endif
+#if !defined(_WIN32)
+	pthread_t workers[AIO_WORKERS];
+	int workerCount;
+	pthread_mutex_t lock;
+	pthread_cond_t work,finished;
+	aioReq * queueHead,*queueTail;
+	bool stopping;
+#endif
 
+}aioStruct;
 
-	}
+typedef struct aioStreamStruct{ // Chunked sequential reader or writer over a whole file
 
+	aioStruct io;
+	aioReq reqs[AIO_STREAM_BUFS];
+	char * mem;
+	long long offset; // of the next chunk to submit
+	int cur; // reader : chunk handed out last, writer : chunk being filled
+	size_t fill;
+	bool writing,held,failed,ended; // ended : a reader got to the end of the file
 
-	return retFlag;
+}aioStream;
 
+typedef struct slotWriterStruct{ // Record sized writes at scattered slots, AIO_DEPTH at a time
 
-}
+	aioStruct io;
+	aioReq reqs[AIO_DEPTH];
+	char * stage; // a copy of each record in flight
+	int next,fd;
+	bool failed;
 
+}slotWriter;
 
+typedef struct logQueueStruct{ // displayMessage's records, written LOG_BATCH at a time
 
+	aioStruct io;
+	aioReq req; // one write in flight at most, so the log keeps its order
+	errStruct batch[2][LOG_BATCH]; // one being filled while the other is written
+	int active,fill;
+	bool ready;
+#if !defined(_WIN32)
+	pthread_mutex_t lock; // shard threads can log errors too
+#endif
 
-static bool self_init(){
+}logQueueStruct;
 
+static int aioMode = -1; // -aio : backend to use, -1 for the best available
 
-	logFile = fopen("log.bin","ab+");
+static logQueueStruct logQueue;
 
+static FILE * logFile = NULL;
 
+static int changesMade = 0,fileOverwrittenFlag= 0;
 
-	if(logFile == NULL){
+static int totalNodes;
 
-		return false;
+static int verbosity = VERB_NORMAL;
 
-	}else{
+static idxStruct empIndex; // index over the session's employee list
 
-		time_t t = time(NULL);
-		struct tm *tmp = gmtime(&t);
-		
+static unsigned int storeEpoch = 1; // bumped by every snapshot, stamped on inserts and deletes
 
-		if(initErrorStruct((tmp->tm_year)+1900,(tmp->tm_mon)+1,tmp->tm_mday,tmp->tm_wday)){
+static int liveSnapshots = 0,zombieNodes = 0; // zombies : deleted nodes kept linked for snapshots
 
-			return true;
+static optStruct options = {false,0,0,-1,NULL,NULL,NULL,0,false,0,NULL,0,64,256};
 
-		}else{
+static shardStruct * shards = NULL;
 
-			return false;
+static int shardCount = 0,shardCache = 0;
 
-		}
 
-		
-		
+int recursiveSearch(struct  Person ** hNode, int nodeCount,int searchVal);
 
-	}
+void throwError(int errorCode , int lineNo); //Prints an error message and line number.
 
-	
-}
+void displayMessage(int msgCode,int val); //Prints appropriate message according to predefined message code.
 
+int insertNode(struct Person ** headNode , struct Person newNode); // inserts node and returns 0 (can be used later for error codes)
 
+int printList(struct Person * headNode, int printList); // Returns the total number of items
 
-void done(){
+int aggregateList(struct Person * headNode, aggStruct * agg); // Runs the aggregation described in agg (see aggParseQuery) over the list, returns the number of groups or -1
 
-	if(fileOverwrittenFlag == 1){
+static bool aggParseQuery(const char * query, aggStruct * agg); // "group=none|age|domain&band=N&field=age|id|phone", false on a bad query
 
-		displayMessage(8,0);
-	}else{
+static int aggFormat(aggStruct * agg, char * buf, int bufLen); // Writes the result table into buf, returns its length
 
-		displayMessage(7,0);
-	}
+int importFile(struct Person ** headNode, char * path); // Streams a CSV or JSON-lines file into the list through insertNode. Returns records inserted, -1 if the file can't be read
 
-	displayMessage(6,0);
+int exportFile(struct Person * headNode, char * path); // Streams the list out as CSV or JSON-lines. Returns records written, -1 if the file can't be written
 
-	fclose(logFile);
+static int fileFormat(const char * path); // FMT_JSONL for .json/.jsonl/.ndjson, FMT_CSV otherwise
 
-}
+int printRange(int loId, int hiId, int limit); // Prints records with loId <= id <= hiId in id order, at most limit (-1 : all). Returns the number printed.
 
+int searchList(struct Person * headN, int searchVal, int searchFlag); //searches the list for a value. If found, returns the position (starting from 1), else 0; a lazy store returns the record's file slot instead, SEARCH_UNSAVED for one not saved yet; (Index lookup, O(log n); a hit with searchFlag 1 still walks to get the position)
 
-int overwriteFile(struct Person ** newHead, char fileName[20]){
+int deleteNode (struct Person ** firstNode, int delVal); // deletes a list and returns 1 if sucessfully deletes, 0 if not found;
 
+struct Person * deleteList(struct Person ** entryNode); // deletes the entire list except for the head. Set's head to NULL;
 
-	FILE * overWrite = fopen(fileName,"wb");
-	printf("\nOverWrite FileName : %s\n",fileName);
+void printInfo(struct Person Node); //  Prints a node information
 
-	int retFlag = 0;
+static void printLine(const struct Person * rec); // Prints a node on one line ("| id - fName - ... "), as the listings do
 
-	if(overWrite != NULL && *newHead != NULL){
-		fseek(overWrite,0,SEEK_SET);
-		retFlag = 1;
-		struct Person * walker = (struct Person*)malloc(sizeof(struct Person));
-		walker = *newHead;
-		//rewind(overWrite);
+static void personCopy(struct Person * dst, const struct Person * src); // Copies the stored fields, leaves next and the epochs alone
 
+static unsigned int personDiff(const struct Person * a, const struct Person * b); // Bit PF_x set for every stored field that differs, 0 if the records match
 
-		while(walker != NULL){
+static int personField(const char * name, int len); // PF_* of the field called name (len chars), -1 if there isn't one
 
-			fwrite(walker,sizeof(struct Person),1,overWrite);
-			printf("\nId : %d",walker->id);
-			walker = walker->next;
-		}
+int overwriteFile(struct Person ** newHead, char fileName[FILENAME_MAX]); // Overwrites the files with new information
 
-		deleteList(newHead);
-		//displayMessage(8);
-		fileOverwrittenFlag=1;
-		//free(*newHead);
-		fclose(overWrite);
+int saveChanges(struct Person ** newHead, char * fileName); // Writes only the records added or deleted since the load/last save, in place. Returns 1 on success like overwriteFile
 
-	}else{
+static void markDirty(idxStruct * idx, struct idxNode * entry); // Queues the entry's record for the next saveChanges
 
-		throwError(4,__LINE__);
-	}
+static void releaseSlot(idxStruct * idx, long slot, bool punched); // Adds a data file slot to the free map
+ 
+static bool self_init(); //Initializes log file and errStruct, returns false on failure
 
+int netLog(struct Person * headNode); // Reads the log and passes it over a tcp network. (Currently set to localhost:8080); GET /agg?<query> answers an aggregation instead
 
-	return retFlag;
-}
+void readLog(); // Reads the log and prints the log on the standard console screen (calls printErrLog() function)
 
+void printErrLog(errStruct a); // Reades the errStruct structure and prints the inforamtion in a human readable manner.
 
+static bool initErrorStruct(int year, int month, int dOfMonth, int dOfWeek);
 
-// Prints information of the structure passed;
-//***************************************************
-void printInfo(struct Person Node){
+static void clockStamp(errStruct * stamp); // Fills the date and time of day fields of a log record with the current UTC time
 
+static void aioInit(aioStruct * io, int workers); // Sets up a context on the best backend allowed (workers : size of a fallback pool)
 
+static void aioSubmit(aioStruct * io, aioReq * req); // Queues req, its buffer must stay put until aioWait returns for it
 
-	printf("\n*************************************\n*\t\tEmployee Info\t\t*\n******************************************\n");
-	printf("Emp. ID: %d\nFirst Name: %s\nLast Name: %s\nAge: %d\nE-Mail: %s\nPhone : %lu\n",Node.id,Node.fName,Node.lName,Node.age,Node.emailAddress,Node.phone);
+static void aioWait(aioStruct * io, aioReq * req); // Blocks until req is done (returns at once for one never submitted)
 
+static void aioClose(aioStruct * io); // Tears the context down, nothing may be in flight
 
-}
+static bool streamOpen(aioStream * s, FILE * fp, bool writing); // Starts a chunked read (from offset 0, read ahead queued) or write of fp
 
+static char * streamRead(aioStream * s, size_t * len); // Next chunk of the file in order, NULL at the end or on error (streamClose tells them apart)
 
+static bool streamWrite(aioStream * s, const void * data, size_t len); // Appends data, full chunks go out in the background
 
-// Delete the entire list-->Set head=NUll and return head;
-//**********************************************************************
-struct Person * deleteList(struct Person ** entryNode){
+static bool streamClose(aioStream * s); // Writes what's left and waits for everything, false if any transfer failed
 
+static bool slotWriterOpen(slotWriter * w, FILE * fp); // Scattered record writes to fp
 
-	if(*entryNode == NULL){ //If head is NULL, throws and error and returns the head..
+static bool slotWrite(slotWriter * w, long slot, const void * rec); // Queues one record at slot (copied, rec can change right away)
 
-		throwError(-1,__LINE__);
-	}else{ //delete every node except head.. Set head to NULL
+static bool slotWriterClose(slotWriter * w); // Waits for all writes, false if any failed
 
+static void logQueueInit(); // Sets up batched log writes to logFile
 
-		struct Person* current = *entryNode;
-		struct Person* next;
-		while(current != NULL){
-			
-			next = current->next;
-			free(current);
-			current = next;
+static void logAppend(const errStruct * rec); // Queues a record for the log
 
-		}
+static void logFlush(); // Writes whatever the log queue holds and waits for it (before the log is read)
 
-		changesMade = 1;
-	}
+static void logCheck(); // Reports the log queue's finished write if it failed
 
-	*entryNode = NULL;
-	return *entryNode;
-}
+static bool traceExport(const char * path); // Writes every thread's spans to path, false if there's nothing to write or it can't be written
 
+static struct idxNode * idxFind(idxStruct * idx, int id); // Returns the index entry for id, NULL if absent
 
-void displayMessage(int msgCode, int val){
+static struct idxNode * idxInsert(idxStruct * idx, int id, struct Person * rec, struct Person * prev); // Adds an entry for id, NULL on duplicate or allocation failure
 
+static bool idxRemove(idxStruct * idx, int id); // Drops the entry for id, false if absent
 
+static void idxClear(idxStruct * idx); // Frees every entry and resets the index
 
-	time_t t = time(NULL);
-	struct tm *tmp = gmtime(&t);
-		
-	static int a =0;
-	
-	
+static bool bloomMayContain(idxStruct * idx, int id); // false only if id is certainly not indexed
 
-	errStruct tempLog;
+static void bloomAdd(idxStruct * idx, int id); // Sets id's bits, rebuilding first if the filter is full
 
+static void bloomRebuild(idxStruct * idx); // Sizes the filter for the index and refills it from the entries (also retries one that failed)
 
-	tempLog.errYear = sessionErrorInit.errYear;
-	tempLog.errMonth = sessionErrorInit.errMonth;
-	tempLog.errDoM = sessionErrorInit.errDoM;
-	tempLog.errDoW = sessionErrorInit.errDoW;
+static void bloomGrow(idxStruct * idx); // bloomRebuild from the insert/delete paths, skipped while the filter is off
 
-	tempLog.errToD = tmp->tm_hour;
-	tempLog.errM = tmp->tm_min;
-	tempLog.errS = tmp->tm_sec;
-	tempLog.valAssocFlag = 0;
+static idxCursor idxSeek(idxStruct * idx, int loId, int hiId); // Cursor at the first id >= loId
 
-	switch(msgCode){
+static struct Person * idxNext(idxCursor * cursor); // Next record of the range, NULL once past hiId
 
+snapStruct takeSnapshot(struct Person * headNode); // Stable view of the list as it is now. Must be released.
 
+void releaseSnapshot(snapStruct * snap); // Ends the view
 
-		case(1):
+static void reapZombies(struct Person ** headNode); // Unlinks nodes deleted while snapshots were held, once none are left
 
-			printf("\nValue %d Deleted Sucessfully...",val);
-			tempLog.valAssocFlag = true;
-			tempLog.valueAssoc = val;
+struct Person * snapNext(snapStruct * snap, struct Person * node); // Next node visible in the snapshot after node (NULL : first), NULL at the end
 
-			strcpy(tempLog.errMessage,"Value Deleted :");
-			break;
+static bool lazyOpen(idxStruct * idx, const char * path, int cacheSize); // Indexes the ids of a data file without loading the records (none if it doesn't exist yet), false on failure
 
-		case(2):
+static struct Person * entryRecord(idxStruct * idx, struct idxNode * entry); // The entry's record, read into the cache if needed. NULL if it can't be read
 
-			printf("\nList Sucessfully Deleted..\n");
-			
-			strcpy(tempLog.errMessage,"\nList Sucessfully Deleted..");
-			
-			break;
+static void lazyForget(idxStruct * idx, struct idxNode * entry); // Lets go of the entry's in-memory record before the entry is removed
 
-		case(3):
+static void lazyClose(idxStruct * idx);
 
-			printf("\nValue %d not found..\n\n",val);
-			tempLog.valAssocFlag = true;
-			tempLog.valueAssoc = val;
+static bool scanOpen(scanStruct * scan, struct Person * headNode); // Starts a sequential read of the store
 
-			strcpy(tempLog.errMessage,"Value Not Found :");
-			
-			break;
+static struct Person * scanNext(scanStruct * scan); // Next live record, NULL at the end
 
-		case(4):
+static void scanClose(scanStruct * scan);
 
-			printf("\nThe list is empty..\n\n");
-			strcpy(tempLog.errMessage,"The list is empty..");
-			
-			break;
-		case(5):
+static bool scanOpenIndex(scanStruct * scan, idxStruct * idx); // Starts a sequential read of one lazy index's file
 
-			printf("\nFile Sucessfully Overwritten\n");
-			strcpy(tempLog.errMessage,"File Sucessfully Overwritten");
-		
-			break;
+static bool shardsInit(const char * base, int count, int cacheSize); // Sets up count shards named base.0 .. base.count-1, none opened yet
 
-		case(6):
+static bool shardOpenAll(); // Opens every shard not opened yet (in parallel), false if one failed
 
-			printf("\n\nNow exiting the program....\n\n");
-			strcpy(tempLog.errMessage,"Now exiting the program....");
-		
-			break;
-		
-		case(7):
+static idxStruct * storeIndex(int id); // The index id belongs to : its shard's (opened on demand) or empIndex. NULL if the shard can't be opened
 
-			printf("\n[EXIT MESSAGE] : No changes were made to the file.\n");
-			strcpy(tempLog.errMessage,"[EXIT MESSAGE] : No changes were made to the file.");
-			
-			break;
+static int storeCount(); // Employees in the store (opened shards only)
 
-		case(8):
+static bool shardParallel(void * (*task)(void *)); // Runs task on every shard, a thread each, false if it failed on any
 
-			printf("\n[EXIT MESSAGE] : Changes were made to the file\n");
-			strcpy(tempLog.errMessage,"[EXIT MESSAGE] : Changes were made to the file");
-		
-			break;
+static void * shardCompactTask(void * arg); // compactIndex on an opened shard
 
-		case(9):
+static void shardsClose(); // Clears every shard's index, the files stay
 
-			printf("\n[ERR] : Program Failed to Initialize.\n");
-			strcpy(tempLog.errMessage,"[ERR] : Program Failed to Initialize.");
+static int saveIndex(idxStruct * idx, const char * fileName, long * written, long * punched); // Writes one index's changes to its data file, 1 on success
+
+static int compactIndex(idxStruct * idx, const char * fileName, long * written); // Rewrites one lazy index's data file with its live records and clears the index, 1 on success
+
+static bool parseArgs(int argc, char *argv[], char ** dataFile); // Reads the data file name and option flags, returns false on bad usage
+
+SOCKET InitializeSocket();
+
+
+
+
+
+SOCKET InitializeSocket(){
+
+
+		//printf("Configuring local address...\n");
+		displayMessage(10,0);
+		struct addrinfo hints; // declar a addrinfo structure
+	 
+		memset(&hints, 0, sizeof(hints)); // Fill it will 0 values	 
+		hints.ai_family = AF_INET; // IPv4 (AF_INET6 for IPv6);
+		hints.ai_socktype = SOCK_STREAM; // for TCP connection (SOCK_DGRAM for UDP).
+		hints.ai_flags = AI_PASSIVE; // Any network interface available. Has to be set before callind getaddrinfo. 
+		struct addrinfo *bind_address; // pointer to an addrinfo struct to save the values reteurned by getaddrinfo();
+
+		getaddrinfo(0, "8080", &hints, &bind_address); // First param NULL, 2nd: Port to listen on, hints: What we're looking for
+															// bindaddress:: return buffer.
+		//printf("Creating socket...\n");
+		displayMessage(11,0);
+		SOCKET socket_listen; // Create a socket.. In Wondows, it's WINSOCK type. On UNIX enviroment , it's an unsigned int (file descriptor)
+
+					//socket: parameters  //socket family, socket type and socket protocol
+					//returns -ve int on UNIX enviroment and INVALID_SOCKET error on Windows enviroment;
+		socket_listen = socket(bind_address->ai_family,bind_address->ai_socktype, bind_address->ai_protocol);
+		if (!ISVALIDSOCKET(socket_listen)) { // If invalid, get errorNo , WSAGetLastError() on Windows, errno on UNIX enviroment;
+				freeaddrinfo(bind_address);
+				return INVALID_SOCKET;		
+		}
+
+		int reuse = 1; // a restart doesn't have to wait for the last run's connections to leave TIME_WAIT
+		setsockopt(socket_listen,SOL_SOCKET,SO_REUSEADDR,(const char *)&reuse,sizeof(reuse));
+		
+		//("Binding socket to local address...\n");
+
+
+		// Binding the socket too a local address, 
+		// bind() returns 0 on success and non-zero on failure.
+		if (bind(socket_listen,bind_address->ai_addr, bind_address->ai_addrlen)) {  //  If non-zero, throw error.
+				//fprintf(stderr, "bind() failed. (%d)\n", GETSOCKETERRNO());
+				freeaddrinfo(bind_address); // Now that we've binded the socket, free the memory for addrinfo;
+				return INVALID_SOCKET;
+		}
+		freeaddrinfo(bind_address); // Now that we've binded the socket, free the memory for addrinfo;
+		//displayMessage(14,8080);
+		//printf("Listening...\n"); //
+	
+		VPRINTF(VERB_NORMAL,"Waiting for connection...\n");
+		return socket_listen;
+}
+
+
+void printErrLog( errStruct a){
+
+
+	if(a.valAssocFlag){
+		printf("\n[ERR LOG] [ %d/%d/%d  %d:%d:%d ] %s %d",a.errDoM,a.errMonth,a.errYear,a.errToD,a.errM,a.errS,a.errMessage,a.valueAssoc);
+	}else{
+
+		printf("\n[ERR LOG] [ %d/%d/%d  %d:%d:%d ] %s",a.errDoM,a.errMonth,a.errYear,a.errToD,a.errM,a.errS,a.errMessage);
+	}
+	
+
+
+}
+
+static bool initErrorStruct(int year, int month, int dOfMonth, int dOfWeek){
+
+	bool retFlag = false;
+
+	sessionErrorInit.errYear = year;
+	sessionErrorInit.errMonth = month;
+	sessionErrorInit.errDoM = dOfMonth;
+	sessionErrorInit.errDoW = dOfWeek;
+	sessionErrorInit.valAssocFlag = false;
+
+	strncpy(sessionErrorInit.errTimeZone,"UTC\0",4);
+
+	retFlag = true;
+	return retFlag;
+
+}
+
+
+static long long clockSeconds(){
+
+#if defined(CLOCK_REALTIME_COARSE)
+	struct timespec ts;
+
+	if(clock_gettime(CLOCK_REALTIME_COARSE,&ts) == 0){ // vDSO read of the last tick, no syscall
+		return (long long)ts.tv_sec;
+	}
+#endif
+	return (long long)time(NULL);
+}
+
+
+static void clockStamp(errStruct * stamp){
+
+	long long now = clockSeconds();
+	long long day,rem;
+	time_t t;
+	struct tm tmBuf;
+	struct tm * tmp;
+
+	if(now != logClock.second){
+
+		day = now / 86400;
+		rem = now % 86400;
+		if(rem < 0){ // before 1970, keep the remainder positive
+			rem += 86400;
+			day--;
+		}
+
+		if(day != logClock.day){ // a new day (or the first stamp) : the one full conversion
+
+			t = (time_t)now;
+			tmp = GMTIME(&t,&tmBuf); // gmtime's own buffer is shared between threads
+			if(tmp != NULL){
+				logClock.year = tmp->tm_year + 1900;
+				logClock.month = tmp->tm_mon + 1;
+				logClock.dOfMonth = tmp->tm_mday;
+				logClock.dOfWeek = tmp->tm_wday;
+				logClock.day = day;
+			}
+		}
+
+		logClock.hour = (int)(rem / 3600); // UTC has no DST, the time of day is plain arithmetic
+		logClock.min = (int)(rem / 60 % 60);
+		logClock.sec = (int)(rem % 60);
+		logClock.second = now;
+	}
+
+	stamp->errYear = logClock.year;
+	stamp->errMonth = logClock.month;
+	stamp->errDoM = logClock.dOfMonth;
+	stamp->errDoW = logClock.dOfWeek;
+	stamp->errToD = logClock.hour;
+	stamp->errM = logClock.min;
+	stamp->errS = logClock.sec;
+}
+
+
+// Asynchronous file I/O
+//***************************************************************************************
+static long aioTransfer(aioReq * req){ // the whole request, synchronously
+
+	size_t moved = 0;
+	long n;
+
+	while(moved < req->len){
+
+#if defined(_WIN32)
+		if(req->offset >= 0){
+			_lseeki64(req->fd,req->offset+(long long)moved,SEEK_SET);
+		}
+		n = req->write ? _write(req->fd,req->buf+moved,(unsigned int)(req->len-moved)) : _read(req->fd,req->buf+moved,(unsigned int)(req->len-moved));
+#else
+		if(req->offset >= 0){
+			n = req->write ? (long)pwrite(req->fd,req->buf+moved,req->len-moved,(off_t)(req->offset+(long long)moved)) : (long)pread(req->fd,req->buf+moved,req->len-moved,(off_t)(req->offset+(long long)moved));
+		}else{
+			n = req->write ? (long)write(req->fd,req->buf+moved,req->len-moved) : (long)read(req->fd,req->buf+moved,req->len-moved);
+		}
+		if(n < 0 && errno == EINTR){
+			continue;
+		}
+#endif
+		if(n < 0){
+			return (moved > 0) ? (long)moved : -1;
+		}
+		if(n == 0){ // end of file
 			break;
-		case(10):
-			printf("\nConfiguring local address...\n");
-			strcpy(tempLog.errMessage,"[MSG] : Configuring local address...");
+		}
+		moved += (size_t)n;
+	}
+
+	return (long)moved;
+}
+
+
+#if defined(AIO_HAVE_URING)
+
+static bool uringSetup(aioStruct * io){
+
+	struct io_uring_params p;
+	int fd;
+
+	memset(&p,0,sizeof(p));
+	fd = (int)syscall(__NR_io_uring_setup,AIO_DEPTH,&p);
+	if(fd < 0){
+		return false; // old kernel, or turned off (kernel.io_uring_disabled, seccomp)
+	}
+
+	if(!(p.features & IORING_FEAT_RW_CUR_POS)){ // the log is written at offset -1 (the current position), before 5.6 that's EINVAL
+		close(fd);
+		return false;
+	}
+
+	io->sqMapLen = p.sq_off.array + p.sq_entries*sizeof(unsigned);
+	io->cqMapLen = p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP){
+		io->sqMapLen = io->cqMapLen = (io->sqMapLen > io->cqMapLen) ? io->sqMapLen : io->cqMapLen;
+	}
+	io->sqesLen = p.sq_entries*sizeof(struct io_uring_sqe);
+
+	io->sqMap = mmap(NULL,io->sqMapLen,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+	io->cqMap = (p.features & IORING_FEAT_SINGLE_MMAP) ? io->sqMap : mmap(NULL,io->cqMapLen,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_CQ_RING);
+	io->sqes = (struct io_uring_sqe *)mmap(NULL,io->sqesLen,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQES);
+
+	if(io->sqMap == MAP_FAILED || io->cqMap == MAP_FAILED || (void *)io->sqes == MAP_FAILED){
+
+		if(io->sqMap != MAP_FAILED){
+			munmap(io->sqMap,io->sqMapLen);
+		}
+		if(io->cqMap != MAP_FAILED && io->cqMap != io->sqMap){
+			munmap(io->cqMap,io->cqMapLen);
+		}
+		if((void *)io->sqes != MAP_FAILED){
+			munmap(io->sqes,io->sqesLen);
+		}
+		close(fd);
+		return false;
+	}
+
+	io->sqHead = (unsigned *)((char *)io->sqMap + p.sq_off.head);
+	io->sqTail = (unsigned *)((char *)io->sqMap + p.sq_off.tail);
+	io->sqMask = (unsigned *)((char *)io->sqMap + p.sq_off.ring_mask);
+	io->sqArray = (unsigned *)((char *)io->sqMap + p.sq_off.array);
+	io->cqHead = (unsigned *)((char *)io->cqMap + p.cq_off.head);
+	io->cqTail = (unsigned *)((char *)io->cqMap + p.cq_off.tail);
+	io->cqMask = (unsigned *)((char *)io->cqMap + p.cq_off.ring_mask);
+	io->cqes = (struct io_uring_cqe *)((char *)io->cqMap + p.cq_off.cqes);
+	io->entries = p.sq_entries;
+	io->ringFd = fd;
+
+	return true;
+}
+
+
+static void uringQueue(aioStruct * io, aioReq * req){ // puts req (what's left of it) on the submission ring
+
+	unsigned tail = *io->sqTail;
+	unsigned k = tail & *io->sqMask;
+	struct io_uring_sqe * sqe = &io->sqes[k];
+
+	req->iov.iov_base = req->buf + req->moved;
+	req->iov.iov_len = req->len - req->moved;
+
+	memset(sqe,0,sizeof(struct io_uring_sqe));
+	sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV; // the vectored ops go back to the first io_uring kernels
+	sqe->fd = req->fd;
+	sqe->addr = (unsigned long long)(size_t)&req->iov;
+	sqe->len = 1;
+	sqe->off = (req->offset >= 0) ? (unsigned long long)(req->offset + (long long)req->moved) : (unsigned long long)-1;
+	sqe->user_data = (unsigned long long)(size_t)req;
+
+	io->sqArray[k] = k;
+	__atomic_store_n(io->sqTail,tail+1,__ATOMIC_RELEASE);
+	io->unsubmitted++;
+}
+
+
+static void uringReap(aioStruct * io){
+
+	unsigned head = *io->cqHead;
+	unsigned tail = __atomic_load_n(io->cqTail,__ATOMIC_ACQUIRE);
+	struct io_uring_cqe * cqe;
+	aioReq * req;
+
+	while(head != tail){
+
+		cqe = &io->cqes[head & *io->cqMask];
+		req = (aioReq *)(size_t)cqe->user_data;
+		head++;
+
+		if(cqe->res > 0 && req->moved + (size_t)cqe->res < req->len){ // short transfer, send the rest
+
+			req->moved += (size_t)cqe->res;
+			uringQueue(io,req);
+			continue;
+		}
+
+		if(cqe->res >= 0){
+			req->moved += (size_t)cqe->res;
+			req->result = (long)req->moved;
+		}else{
+			req->result = (req->moved > 0) ? (long)req->moved : -1;
+		}
+		req->done = true;
+		io->inFlight--;
+	}
+
+	__atomic_store_n(io->cqHead,head,__ATOMIC_RELEASE);
+}
+
+
+static void uringEnter(aioStruct * io, bool wait){
+
+	int n = (int)syscall(__NR_io_uring_enter,io->ringFd,io->unsubmitted,wait ? 1 : 0,wait ? IORING_ENTER_GETEVENTS : 0,NULL,0);
+
+	if(n > 0){
+		io->unsubmitted -= (unsigned)n;
+	}
+}
+
+#endif
+
+
+#if !defined(_WIN32)
+
+static void * aioWorker(void * arg){
+
+	aioStruct * io = (aioStruct *)arg;
+	aioReq * req;
+	long result;
+
+	pthread_mutex_lock(&io->lock);
+	for(;;){
+
+		while(io->queueHead == NULL && !io->stopping){
+			pthread_cond_wait(&io->work,&io->lock);
+		}
+		if(io->queueHead == NULL){ // stopping, and nothing left
 			break;
-		case(11):
-			printf("\nCreating socket...\n");
-			strcpy(tempLog.errMessage,"[MSG] : Creating socket...");
+		}
+
+		req = io->queueHead;
+		io->queueHead = req->next;
+		if(io->queueHead == NULL){
+			io->queueTail = NULL;
+		}
+		pthread_mutex_unlock(&io->lock);
+
+		result = aioTransfer(req);
+
+		pthread_mutex_lock(&io->lock);
+		req->result = result;
+		req->done = true;
+		pthread_cond_broadcast(&io->finished);
+	}
+	pthread_mutex_unlock(&io->lock);
+
+	return NULL;
+}
+
+#endif
+
+
+static void aioInit(aioStruct * io, int workers){
+
+	int want = (aioMode >= 0) ? aioMode : AIO_URING;
+
+	memset(io,0,sizeof(aioStruct));
+	io->backend = AIO_SYNC;
+
+#if defined(AIO_HAVE_URING)
+	if(want == AIO_URING && uringSetup(io)){
+		io->backend = AIO_URING;
+		return;
+	}
+#endif
+
+#if !defined(_WIN32)
+	if(want >= AIO_THREADS){
+
+		pthread_mutex_init(&io->lock,NULL);
+		pthread_cond_init(&io->work,NULL);
+		pthread_cond_init(&io->finished,NULL);
+
+		workers = (workers > AIO_WORKERS) ? AIO_WORKERS : workers;
+		while(io->workerCount < workers && pthread_create(&io->workers[io->workerCount],NULL,aioWorker,io) == 0){
+			io->workerCount++;
+		}
+
+		if(io->workerCount > 0){
+			io->backend = AIO_THREADS;
+		}else{
+			pthread_mutex_destroy(&io->lock);
+			pthread_cond_destroy(&io->work);
+			pthread_cond_destroy(&io->finished);
+		}
+	}
+#else
+	(void)want;
+	(void)workers;
+#endif
+}
+
+
+static void aioSubmit(aioStruct * io, aioReq * req){
+
+	req->done = false;
+	req->result = 0;
+	req->moved = 0;
+	req->next = NULL;
+
+	switch(io->backend){
+
+#if defined(AIO_HAVE_URING)
+		case(AIO_URING):
+
+			while(io->inFlight >= io->entries){ // ring full, make room
+
+				uringEnter(io,true);
+				uringReap(io);
+			}
+			uringQueue(io,req);
+			io->inFlight++;
+			uringEnter(io,false);
 			break;
-		case(12):
-			printf("\nSocket Initialization failed (%d)..\n\n",val);
-			tempLog.valAssocFlag = true;
-			tempLog.valueAssoc = val;
-			strcpy(tempLog.errMessage,"Socket Initialization Failed. ");
+#endif
+
+#if !defined(_WIN32)
+		case(AIO_THREADS):
+
+			pthread_mutex_lock(&io->lock);
+			if(io->queueTail != NULL){
+				io->queueTail->next = req;
+			}else{
+				io->queueHead = req;
+			}
+			io->queueTail = req;
+			pthread_cond_signal(&io->work);
+			pthread_mutex_unlock(&io->lock);
 			break;
-		case(13):
-			printf("\nBinding socket to local address...\n");
-			strcpy(tempLog.errMessage,"[MSG] : Binding socket to local address...");
+#endif
+
+		default:
+
+			req->result = aioTransfer(req);
+			req->done = true;
 			break;
-		case(14):
-			tempLog.valAssocFlag = true;
-			tempLog.valueAssoc = val;
-			printf("\nSocket Listening on Port %d [Awaiting Connection]",val);
-			strcpy(tempLog.errMessage,"[MSG]: Socket Listening [Awaiting Connection] on Port ");
+	}
+}
+
+
+static void aioWait(aioStruct * io, aioReq * req){
+
+	switch(io->backend){
+
+#if defined(AIO_HAVE_URING)
+		case(AIO_URING):
+
+			uringReap(io);
+			while(!req->done){
+
+				uringEnter(io,true);
+				uringReap(io);
+			}
 			break;
-		case(15):
-			tempLog.valAssocFlag = true;
-			tempLog.valueAssoc = val;
-			printf("\nClient Connected on Port %d\n",val);
-			strcpy(tempLog.errMessage,"[MSG] : Client Connected on Port : ");
+#endif
+
+#if !defined(_WIN32)
+		case(AIO_THREADS):
+
+			pthread_mutex_lock(&io->lock);
+			while(!req->done){
+				pthread_cond_wait(&io->finished,&io->lock);
+			}
+			pthread_mutex_unlock(&io->lock);
+			break;
+#endif
+
+		default:
 			break;
-			
 	}
+}
+
+
+static void aioClose(aioStruct * io){
+
+	int k;
+
+#if defined(AIO_HAVE_URING)
+	if(io->backend == AIO_URING){
+
+		munmap(io->sqes,io->sqesLen);
+		if(io->cqMap != io->sqMap){
+			munmap(io->cqMap,io->cqMapLen);
+		}
+		munmap(io->sqMap,io->sqMapLen);
+		close(io->ringFd);
+	}
+#endif
+
+#if !defined(_WIN32)
+	if(io->backend == AIO_THREADS){
+
+		pthread_mutex_lock(&io->lock);
+		io->stopping = true;
+		pthread_cond_broadcast(&io->work);
+		pthread_mutex_unlock(&io->lock);
+
+		for(k=0;k<io->workerCount;k++){
+			pthread_join(io->workers[k],NULL);
+		}
+		pthread_mutex_destroy(&io->lock);
+		pthread_cond_destroy(&io->work);
+		pthread_cond_destroy(&io->finished);
+	}
+#endif
+
+	(void)k;
+	memset(io,0,sizeof(aioStruct));
+}
+
+
+static bool streamOpen(aioStream * s, FILE * fp, bool writing){
+
+	int k;
+
+	memset(s,0,sizeof(aioStream));
+	s->mem = (char *)malloc((size_t)AIO_STREAM_BUFS*AIO_CHUNK);
+	if(s->mem == NULL){
+		throwError(3,__LINE__);
+		return false;
+	}
+
+	fflush(fp); // the stream goes around stdio, nothing may be left in its buffer
+	aioInit(&s->io,AIO_WORKERS);
+	s->writing = writing;
+
+	for(k=0;k<AIO_STREAM_BUFS;k++){
+
+		s->reqs[k].fd = fileno(fp);
+		s->reqs[k].buf = s->mem + (size_t)k*AIO_CHUNK;
+		s->reqs[k].write = writing;
+		s->reqs[k].done = true;
+
+		if(!writing){ // read ahead the first chunks
+
+			s->reqs[k].len = AIO_CHUNK;
+			s->reqs[k].offset = s->offset;
+			s->offset += AIO_CHUNK;
+			aioSubmit(&s->io,&s->reqs[k]);
+		}
+	}
+
+	return true;
+}
+
+
+static char * streamRead(aioStream * s, size_t * len){
+
+	aioReq * r;
+
+	if(s->failed || s->ended){
+		return NULL;
+	}
+
+	if(s->held){ // the caller is done with the last chunk, its buffer reads further ahead
+
+		r = &s->reqs[s->cur];
+		r->offset = s->offset;
+		s->offset += AIO_CHUNK;
+		aioSubmit(&s->io,r);
+		s->cur = (s->cur + 1) % AIO_STREAM_BUFS;
+	}
+
+	r = &s->reqs[s->cur];
+	aioWait(&s->io,r);
+
+	if(r->result <= 0){ // end of file, or an error
+
+		s->held = false;
+		s->ended = true;
+		s->failed = (r->result < 0);
+		return NULL;
+	}
+
+	s->held = true;
+	*len = (size_t)r->result;
+	return r->buf;
+}
+
+
+static void streamFlush(aioStream * s){
+
+	aioReq * r = &s->reqs[s->cur];
+
+	r->len = s->fill;
+	r->offset = s->offset;
+	s->offset += (long long)s->fill;
+	aioSubmit(&s->io,r);
+
+	s->fill = 0;
+	s->cur = (s->cur + 1) % AIO_STREAM_BUFS;
+}
+
+
+static bool streamWrite(aioStream * s, const void * data, size_t len){
+
+	const char * p = (const char *)data;
+	aioReq * r;
+	size_t n;
+
+	while(len > 0 && !s->failed){
+
+		r = &s->reqs[s->cur];
+		if(s->fill == 0){ // reusing this chunk, its last write must be out
+
+			aioWait(&s->io,r);
+			if(r->len != 0 && r->result != (long)r->len){
+				s->failed = true;
+				break;
+			}
+		}
+
+		n = AIO_CHUNK - s->fill;
+		n = (n > len) ? len : n;
+		memcpy(r->buf + s->fill,p,n);
+		s->fill += n;
+		p += n;
+		len -= n;
+
+		if(s->fill == AIO_CHUNK){
+			streamFlush(s);
+		}
+	}
+
+	return !s->failed;
+}
+
+
+static bool streamClose(aioStream * s){
+
+	int k;
+
+	if(s->writing && s->fill > 0 && !s->failed){
+		streamFlush(s);
+	}
+
+	for(k=0;k<AIO_STREAM_BUFS;k++){
+
+		aioWait(&s->io,&s->reqs[k]);
+		if(s->writing && s->reqs[k].len != 0 && s->reqs[k].result != (long)s->reqs[k].len){
+			s->failed = true;
+		}
+	}
+
+	aioClose(&s->io);
+	free(s->mem);
+	s->mem = NULL;
+
+	return !s->failed;
+}
+
+
+static bool slotWriterOpen(slotWriter * w, FILE * fp){
+
+	int k;
+
+	memset(w,0,sizeof(slotWriter));
+	w->stage = (char *)malloc(AIO_DEPTH*PERSON_DISK_SIZE);
+	if(w->stage == NULL){
+		throwError(3,__LINE__);
+		return false;
+	}
+
+	fflush(fp);
+	aioInit(&w->io,AIO_WORKERS);
+	w->fd = fileno(fp);
+	for(k=0;k<AIO_DEPTH;k++){
+		w->reqs[k].done = true;
+	}
+	return true;
+}
+
+
+static bool slotWrite(slotWriter * w, long slot, const void * rec){
+
+	aioReq * r = &w->reqs[w->next];
+
+	aioWait(&w->io,r); // oldest staging buffer
+	if(r->len != 0 && r->result != (long)r->len){
+		w->failed = true;
+	}
+	if(w->failed){
+		return false;
+	}
+
+	r->buf = w->stage + w->next*PERSON_DISK_SIZE;
+	memcpy(r->buf,rec,PERSON_DISK_SIZE);
+	r->fd = w->fd;
+	r->len = PERSON_DISK_SIZE;
+	r->offset = (long long)slot*PERSON_DISK_SIZE;
+	r->write = true;
+	aioSubmit(&w->io,r);
+
+	w->next = (w->next + 1) % AIO_DEPTH;
+	return true;
+}
+
+
+static bool slotWriterClose(slotWriter * w){
+
+	int k;
+
+	for(k=0;k<AIO_DEPTH;k++){
+
+		aioWait(&w->io,&w->reqs[k]);
+		if(w->reqs[k].len != 0 && w->reqs[k].result != (long)w->reqs[k].len){
+			w->failed = true;
+		}
+	}
+
+	aioClose(&w->io);
+	free(w->stage);
+	w->stage = NULL;
+
+	return !w->failed;
+}
+
+
+static void logQueueInit(){
+
+	memset(&logQueue,0,sizeof(logQueue));
+#if !defined(_WIN32)
+	pthread_mutex_init(&logQueue.lock,NULL);
+#endif
+	fflush(logFile);
+	aioInit(&logQueue.io,1);
+	logQueue.req.done = true;
+	logQueue.ready = true;
+
+	VPRINTF(VERB_VERBOSE,"\nFile I/O : %s\n",logQueue.io.backend == AIO_URING ? "io_uring" : (logQueue.io.backend == AIO_THREADS ? "thread pool" : "synchronous"));
+}
+
+
+static void logSubmit(){ // caller holds the lock
+
+	TRACE_BEGIN("log write");
+	aioWait(&logQueue.io,&logQueue.req); // the other batch, so the log stays in order
+	logCheck();
+
+	logQueue.req.fd = fileno(logFile);
+	logQueue.req.buf = (char *)logQueue.batch[logQueue.active];
+	logQueue.req.len = logQueue.fill*sizeof(errStruct);
+	logQueue.req.offset = -1; // log.bin is opened for appending
+	logQueue.req.write = true;
+	aioSubmit(&logQueue.io,&logQueue.req);
+
+	logQueue.active ^= 1;
+	logQueue.fill = 0;
+	TRACE_END();
+}
+
+
+static void logCheck(){ // caller holds the lock, and has waited for the write
+
+	if(logQueue.req.len != 0 && logQueue.req.result != (long)logQueue.req.len){
+		fprintf(stderr, "Writing the error log failed, %ld records lost.\n",(long)((logQueue.req.len - (logQueue.req.result > 0 ? (size_t)logQueue.req.result : 0))/sizeof(errStruct)));
+	}
+	logQueue.req.len = 0; // reported once
+}
+
+
+static void logAppend(const errStruct * rec){
+
+	if(!logQueue.ready){
+
+		if(logFile != NULL){
+			fwrite(rec,sizeof(errStruct),1,logFile);
+		}
+		return;
+	}
+
+#if !defined(_WIN32)
+	pthread_mutex_lock(&logQueue.lock);
+#endif
+	logQueue.batch[logQueue.active][logQueue.fill++] = *rec;
+	if(logQueue.fill == LOG_BATCH){
+		logSubmit();
+	}
+#if !defined(_WIN32)
+	pthread_mutex_unlock(&logQueue.lock);
+#endif
+}
+
+
+static void logFlush(){
+
+	if(!logQueue.ready){
+		return;
+	}
+
+#if !defined(_WIN32)
+	pthread_mutex_lock(&logQueue.lock);
+#endif
+	TRACE_BEGIN("log flush");
+	if(logQueue.fill > 0){
+		logSubmit();
+	}
+	aioWait(&logQueue.io,&logQueue.req);
+	logCheck();
+	TRACE_END();
+#if !defined(_WIN32)
+	pthread_mutex_unlock(&logQueue.lock);
+#endif
+}
+
+
+// Trace points
+// A span is recorded when it begins, so a parent always comes before its children in a
+// thread's buffer; the end fills in the duration and adds it to the parent's child time.
+// That's all the folded (flamegraph) export needs to get self times and stacks.
+//***************************************************************************************
+#if defined(EMP_TRACE)
+
+#define TRACE_MAX_DEPTH 32
+#define TRACE_MAX_EVENTS (1 << 22) // spans kept per thread, later ones are only counted
+
+typedef struct traceEventStruct{
+
+	const char * name;
+	long long start,dur; // nanoseconds
+	long long child; // time spent in nested spans
+	int parent; // index of the enclosing span, -1 at the top
+
+}traceEvent;
+
+typedef struct traceBufStruct{
+
+	traceEvent * events;
+	int count,cap;
+	int stack[TRACE_MAX_DEPTH]; // open spans, -1 for ones that weren't kept
+	int depth;
+	long dropped;
+	int tid;
+	struct traceBufStruct * nextBuf;
+
+}traceBuf;
+
+typedef struct traceNodeStruct{ // folded export : one per distinct stack
+
+	const char * name;
+	int parent,firstChild,nextSibling;
+	long long self;
+
+}traceNode;
+
+static THREAD_LOCAL traceBuf * traceLocal = NULL;
+static traceBuf * traceBufs = NULL; // every thread's buffer, kept after the thread ends
+static int traceThreads = 0;
+static long long traceOrigin = 0;
+#if !defined(_WIN32)
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+static long long traceNow(){
+
+#if defined(_WIN32)
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER c;
+
+	if(freq.QuadPart == 0){
+		QueryPerformanceFrequency(&freq);
+	}
+	QueryPerformanceCounter(&c);
+	return (long long)((double)c.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (long long)ts.tv_sec*1000000000LL + ts.tv_nsec;
+#endif
+}
+
+
+static void traceBegin(const char * name){
+
+	traceBuf * b = traceLocal;
+	traceEvent * grown;
+	int k = -1,d,cap;
+
+	if(b == NULL){ // first span on this thread
+
+		b = (traceBuf *)calloc(1,sizeof(traceBuf));
+		if(b == NULL){
+			return;
+		}
+#if !defined(_WIN32)
+		pthread_mutex_lock(&traceLock);
+#endif
+		b->tid = ++traceThreads;
+		b->nextBuf = traceBufs;
+		traceBufs = b;
+		if(traceOrigin == 0){
+			traceOrigin = traceNow();
+		}
+#if !defined(_WIN32)
+		pthread_mutex_unlock(&traceLock);
+#endif
+		traceLocal = b;
+	}
+
+	if(b->count == b->cap && b->cap < TRACE_MAX_EVENTS){
+
+		cap = b->cap ? b->cap*2 : 4096;
+		grown = (traceEvent *)realloc(b->events,cap*sizeof(traceEvent));
+		if(grown != NULL){
+			b->events = grown;
+			b->cap = cap;
+		}
+	}
+
+	if(b->count < b->cap && b->depth < TRACE_MAX_DEPTH){
+
+		k = b->count++;
+		b->events[k].name = name;
+		b->events[k].dur = 0;
+		b->events[k].child = 0;
+		b->events[k].parent = -1;
+		for(d=b->depth-1;d>=0;d--){ // nearest enclosing span that was kept
+			if(b->stack[d] >= 0){
+				b->events[k].parent = b->stack[d];
+				break;
+			}
+		}
+		b->events[k].start = traceNow();
+
+	}else{
+
+		b->dropped++;
+	}
+
+	if(b->depth < TRACE_MAX_DEPTH){
+		b->stack[b->depth] = k;
+	}
+	b->depth++;
+}
+
+
+static void traceEnd(){
+
+	long long now = traceNow();
+	traceBuf * b = traceLocal;
+	traceEvent * ev;
+	int k;
+
+	if(b == NULL || b->depth == 0){
+		return;
+	}
+
+	b->depth--;
+	k = (b->depth < TRACE_MAX_DEPTH) ? b->stack[b->depth] : -1;
+	if(k >= 0){
+
+		ev = &b->events[k];
+		ev->dur = now - ev->start;
+		if(ev->parent >= 0){
+			b->events[ev->parent].child += ev->dur;
+		}
+	}
+}
+
+
+// Folded stacks : "main;load;insert;dedup 1234", one line per distinct stack with its
+// self time in microseconds, ready for flamegraph.pl or speedscope.
+static bool traceFolded(FILE * out, traceBuf * b){
+
+	traceNode * nodes = (traceNode *)malloc((b->count+1)*sizeof(traceNode));
+	int * nodeOf = (int *)malloc((b->count > 0 ? b->count : 1)*sizeof(int));
+	const char * path[TRACE_MAX_DEPTH+1];
+	int nodeCount = 1,k,p,c,depth;
+	char root[24];
+
+	if(nodes == NULL || nodeOf == NULL){
+		free(nodes);
+		free(nodeOf);
+		return false;
+	}
+
+	if(b->tid == 1){
+		snprintf(root,sizeof(root),"main");
+	}else{
+		snprintf(root,sizeof(root),"thread %d",b->tid);
+	}
+	nodes[0].name = root;
+	nodes[0].parent = -1;
+	nodes[0].firstChild = nodes[0].nextSibling = -1;
+	nodes[0].self = 0;
+
+	for(k=0;k<b->count;k++){ // parents come first, so their node is already known
+
+		p = (b->events[k].parent >= 0) ? nodeOf[b->events[k].parent] : 0;
+		for(c=nodes[p].firstChild;c >= 0 && strcmp(nodes[c].name,b->events[k].name) != 0;c=nodes[c].nextSibling){
+			;
+		}
+		if(c < 0){
+
+			c = nodeCount++;
+			nodes[c].name = b->events[k].name;
+			nodes[c].parent = p;
+			nodes[c].firstChild = -1;
+			nodes[c].nextSibling = nodes[p].firstChild;
+			nodes[c].self = 0;
+			nodes[p].firstChild = c;
+		}
+		nodeOf[k] = c;
+		nodes[c].self += b->events[k].dur - b->events[k].child;
+	}
+
+	for(c=1;c<nodeCount;c++){
+
+		if(nodes[c].self/1000 <= 0){
+			continue;
+		}
+		for(depth=0,p=c;p >= 0 && depth <= TRACE_MAX_DEPTH;p=nodes[p].parent){
+			path[depth++] = nodes[p].name;
+		}
+		while(depth-- > 0){
+			fprintf(out,"%s%c",path[depth],depth > 0 ? ';' : ' ');
+		}
+		fprintf(out,"%lld\n",nodes[c].self/1000);
+	}
+
+	free(nodes);
+	free(nodeOf);
+	return true;
+}
+
+
+static bool traceExport(const char * path){
+
+	FILE * out;
+	traceBuf * b;
+	traceEvent * ev;
+	const char * dot = strrchr(path,'.');
+	bool chrome = (dot != NULL && strcmp(dot,".json") == 0);
+	bool first = true,retFlag = true;
+	long spans = 0,dropped = 0;
+	int k;
+
+	if(traceBufs == NULL){
+		VPRINTF(VERB_NORMAL,"\nNo spans were traced\n");
+		return false;
+	}
+
+	out = fopen(path,"w");
+	if(out == NULL){
+		throwError(7,__LINE__);
+		return false;
+	}
+
+	if(chrome){
+		fprintf(out,"{\"traceEvents\":[");
+	}
+
+	for(b=traceBufs;b != NULL;b=b->nextBuf){
+
+		spans += b->count;
+		dropped += b->dropped;
+
+		if(!chrome){
+
+			retFlag = traceFolded(out,b) && retFlag;
+			continue;
+		}
+
+		fprintf(out,"%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s%d\"}}",first ? "" : ",",b->tid,b->tid == 1 ? "main " : "worker ",b->tid);
+		first = false;
+
+		for(k=0;k<b->count;k++){
+
+			ev = &b->events[k];
+			fprintf(out,",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",ev->name,b->tid,(ev->start-traceOrigin)/1000.0,ev->dur/1000.0);
+		}
+	}
+
+	if(chrome){
+		fprintf(out,"\n],\"displayTimeUnit\":\"ms\"}\n");
+	}
+
+	if(fclose(out) != 0){
+		retFlag = false;
+	}
+
+	VPRINTF(VERB_NORMAL,"\nTrace : %ld spans from %d threads written to %s",spans,traceThreads,path);
+	if(dropped > 0){
+		VPRINTF(VERB_NORMAL," (%ld more not kept, buffer full)",dropped);
+	}
+	VPRINTF(VERB_NORMAL,"\n");
+
+	return retFlag;
+}
+
+#else
+
+static bool traceExport(const char * path){
+
+	(void)path;
+	printf("\nThis build has no trace points (compile with -DEMP_TRACE), -trace ignored\n");
+	return false;
+}
+
+#endif
+
+
+void readLog(){
+
+	errStruct temp;
+	logFlush();
+	fseek(logFile,0,SEEK_SET);
+	if(logFile != NULL){
+
+		while(fread(&temp,sizeof(errStruct),1,logFile) == 1){ // a short read ends it, the last record isn't printed twice
+			printErrLog(temp);
+		}
+	}
+}
+
+
+// Log server
+// One thread, nonblocking sockets and poll. A connection gets an output buffer of
+// NET_CONN_BUF bytes out of a budget of NET_BUDGET shared by all of them; one that can't
+// get a buffer yet waits with its request read. Log lines are only formatted into a
+// buffer once it has drained below NET_LOW_WATER, so a slow reader holds one buffer at
+// most and the log is read no faster than the client takes it. A connection that moves
+// no bytes for NET_IDLE_MS is closed. At -maxconn the listening socket isn't polled, so
+// new clients wait in the kernel's accept queue (-backlog long) instead of in memory.
+//***************************************************************************************
+#define NET_CONN_BUF (64*1024) // output buffer per connection, also the high watermark
+#define NET_LOW_WATER (16*1024) // refilled from the log once it drains below this
+#define NET_BUDGET (8*1024*1024) // all output buffers together
+#define NET_IDLE_MS 10000 // no bytes in or out for this long : closed
+#define NET_REQ_MAX 1024
+#define NET_LOG_BATCH 64 // log records read at a time
+#define NET_LOG_LINE (int)(sizeof(((errStruct *)0)->errMessage) + 16) // longest formatted record
+
+#define NET_READING 0 // waiting for the request line
+#define NET_WAITING 1 // request read, waiting for a buffer from the budget
+#define NET_SENDING 2
+
+typedef struct netConnStruct{
+
+	SOCKET sock;
+	int state; // NET_*
+	char req[NET_REQ_MAX];
+	int reqLen;
+	char * out; // NET_CONN_BUF bytes while sending
+	int outHead,outTail; // unsent bytes are out[outHead..outTail)
+	long logNext,logEnd; // log records still to format
+	long long lastActive; // ms, last time bytes moved
+
+}netConn;
+
+typedef struct netStatsStruct{
+
+	long served,idle,failed;
+	long long bytes;
+	long budgetUsed; // bytes of output buffers handed out
+
+}netStats;
+
+
+static long long netNowMs(){
+
+#if defined(_WIN32)
+	return (long long)GetTickCount64();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+#endif
+}
+
+
+static bool netNonBlocking(SOCKET sock){
+
+#if defined(_WIN32)
+	u_long on = 1;
+	return ioctlsocket(sock,FIONBIO,&on) == 0;
+#else
+	int fl = fcntl(sock,F_GETFL,0);
+	return fl >= 0 && fcntl(sock,F_SETFL,fl | O_NONBLOCK) == 0;
+#endif
+}
+
+
+// Builds the response once the request is in : the whole aggregation table, or the
+// header of a log listing whose lines netFill formats as the buffer drains.
+static void netStart(netConn * c, struct Person * headNode){
+
+	char * query;
+	char * end;
+	aggStruct * agg;
+	int len;
+
+	c->req[c->reqLen] = '\0';
+	c->outHead = c->outTail = 0;
+	c->logNext = c->logEnd = 0;
+
+	if(strncmp(c->req,"GET /agg",8) == 0 && strchr("? \r\n",c->req[8]) != NULL && c->req[8] != '\0'){ // the path is /agg itself, not just a prefix of it
+
+		agg = (aggStruct *)malloc(sizeof(aggStruct));
+		query = (c->req[8] == '?') ? c->req+8 : NULL;
+		if(query != NULL && (end = strpbrk(query," \r\n")) != NULL){
+			*end = '\0';
+		}
+
+		if(agg == NULL){
+
+			throwError(3,__LINE__);
+			len = snprintf(c->out,NET_CONN_BUF,"HTTP/1.1 500 Internal Server Error\r\nConnection: close\r\nContent-Type: text/plain\r\n\r\nout of memory\r\n");
+
+		}else if(!aggParseQuery(query != NULL ? query+1 : "",agg) || aggregateList(headNode,agg) < 0){
+
+			len = snprintf(c->out,NET_CONN_BUF,"HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Type: text/plain\r\n\r\nbad aggregation query\r\n");
+
+		}else{
+
+			len = snprintf(c->out,NET_CONN_BUF,"HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\n\r\n");
+			len += aggFormat(agg,c->out+len,NET_CONN_BUF-len);
+		}
+
+		free(agg);
+
+	}else{
+
+		logFlush(); // queued records aren't in the file yet
+		fseek(logFile,0,SEEK_END);
+		c->logEnd = ftell(logFile) / (long)sizeof(errStruct); // what's there now, later records aren't sent
+		len = snprintf(c->out,NET_CONN_BUF,"HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\n\r\n");
+	}
+
+	c->outTail = len;
+}
+
+
+// Tops the buffer up with log lines, but only once it has drained below the low watermark.
+static void netFill(netConn * c){
+
+	errStruct batch[NET_LOG_BATCH];
+	size_t got,k;
+	int len,want;
+
+	if(c->logNext >= c->logEnd || c->outTail - c->outHead >= NET_LOW_WATER){
+		return;
+	}
+
+	memmove(c->out,c->out+c->outHead,c->outTail-c->outHead);
+	c->outTail -= c->outHead;
+	c->outHead = 0;
+
+	while(c->logNext < c->logEnd && NET_CONN_BUF - c->outTail >= NET_LOG_LINE){
+
+		want = (NET_CONN_BUF - c->outTail) / NET_LOG_LINE;
+		want = want < NET_LOG_BATCH ? want : NET_LOG_BATCH;
+		want = (c->logEnd - c->logNext) < want ? (int)(c->logEnd - c->logNext) : want;
+
+		fseek(logFile,c->logNext*(long)sizeof(errStruct),SEEK_SET);
+		got = fread(batch,sizeof(errStruct),want,logFile);
+		if(got == 0){
+			c->logEnd = c->logNext; // shorter than it was, nothing more to send
+			break;
+		}
+
+		for(k=0;k<got;k++){
+
+			len = (int)strnlen(batch[k].errMessage,sizeof(batch[k].errMessage));
+			memcpy(c->out+c->outTail,batch[k].errMessage,len);
+			c->outTail += len;
+			if(batch[k].valAssocFlag == 1){
+				c->outTail += snprintf(c->out+c->outTail,16,"%d",batch[k].valueAssoc);
+			}
+			c->out[c->outTail++] = '\r';
+			c->out[c->outTail++] = '\n';
+		}
+		c->logNext += (long)got;
+	}
+}
+
+
+// Sends what the socket takes without blocking. False if the client is gone.
+static bool netSend(netConn * c, netStats * stats, long long now){
+
+	int sent;
+
+	while(c->outHead < c->outTail){
+
+		TRACE_BEGIN("send");
+		sent = send(c->sock,c->out+c->outHead,c->outTail-c->outHead,NET_SEND_FLAGS);
+		TRACE_END();
+
+		if(sent < 0){
+			return NET_WOULDBLOCK();
+		}
+		if(sent == 0){
+			break;
+		}
+
+		VPRINTF(VERB_VERBOSE,"\nSent %d of %d bytes.\n",sent,c->outTail-c->outHead);
+		c->outHead += sent;
+		stats->bytes += sent;
+		c->lastActive = now;
+
+		netFill(c);
+	}
+
+	return true;
+}
+
+
+static void netClose(netConn * conns, int k, int * count, netStats * stats){
+
+	if(conns[k].out != NULL){
+
+		free(conns[k].out);
+		stats->budgetUsed -= NET_CONN_BUF;
+	}
+	CLOSESOCKET(conns[k].sock);
+
+	conns[k] = conns[--(*count)]; // the last one takes the slot
+}
+
+
+int netLog(struct Person * headNode){
+
+	int retFlag = 0,count = 0,nfds,base,k,got,timeout;
+	bool accepting = true,serving = (options.serveSecs > 0);
+	long long now,deadline;
+	netConn * conns;
+	struct pollfd * fds;
+	netStats stats;
+	SOCKET sock;
+
+	if(logFile == NULL){
+
+		displayMessage(9,0);
+		return retFlag;
+	}
+
+	SOCKET errSock = InitializeSocket();
+
+	if(!ISVALIDSOCKET(errSock)){
+
+		displayMessage(12,GETSOCKETERRNO());
+		return retFlag;
+	}
+
+	displayMessage(14,8080);
+
+	if(listen(errSock,options.backlog) < 0 || !netNonBlocking(errSock)){ // the backlog is how many connections the kernel queues while we're at -maxconn
+
+		fprintf(stderr, "listen() failed. (%d)\n", GETSOCKETERRNO());
+		CLOSESOCKET(errSock);
+		return 1;
+	}
+
+	conns = (netConn *)calloc(options.maxConn,sizeof(netConn));
+	fds = (struct pollfd *)malloc((options.maxConn+1)*sizeof(struct pollfd));
+	if(conns == NULL || fds == NULL){
+
+		throwError(3,__LINE__);
+		free(conns);
+		free(fds);
+		CLOSESOCKET(errSock);
+		return retFlag;
+	}
+
+	memset(&stats,0,sizeof(stats));
+	deadline = serving ? netNowMs() + options.serveSecs*1000LL : 0;
+	if(serving){
+		VPRINTF(VERB_NORMAL,"\nServing for %d seconds (at most %d connections, accept queue %d)\n",options.serveSecs,options.maxConn,options.backlog);
+	}
+
+	while(accepting || count > 0){
+
+		now = netNowMs();
+		if(serving && now >= deadline){
+			break;
+		}
+
+		nfds = 0;
+		if(accepting && count < options.maxConn){
+
+			fds[nfds].fd = errSock;
+			fds[nfds].events = POLLIN;
+			nfds++;
+		}
+		base = nfds;
+		for(k=0;k<count;k++){
+
+			fds[nfds].fd = conns[k].sock;
+			fds[nfds].events = (conns[k].state == NET_READING) ? POLLIN : (conns[k].state == NET_SENDING ? POLLOUT : 0);
+			nfds++;
+		}
+
+		timeout = 1000; // idle and deadline checks
+		if(serving && deadline - now < timeout){
+			timeout = (int)(deadline - now);
+		}
+
+		got = NETPOLL(fds,nfds,timeout);
+		if(got < 0){
+
+			if(NET_WOULDBLOCK()){
+				continue;
+			}
+			displayMessage(12,GETSOCKETERRNO());
+			break;
+		}
+		now = netNowMs();
+
+		if(base > 0 && (fds[0].revents & POLLIN)){
+
+			while(accepting && count < options.maxConn){
+
+				struct sockaddr_storage client_address;
+				socklen_t client_len = sizeof(client_address);
+
+				sock = accept(errSock,(struct sockaddr*) &client_address, &client_len);
+				if(!ISVALIDSOCKET(sock)){
+					break;
+				}
+				if(!netNonBlocking(sock)){
+
+					CLOSESOCKET(sock);
+					continue;
+				}
+
+				memset(&conns[count],0,sizeof(netConn));
+				conns[count].sock = sock;
+				conns[count].state = NET_READING;
+				conns[count].lastActive = now;
+				count++;
+
+				if(!serving){ // one client, like always
+
+					displayMessage(15,8080);//Client Connected;
+					accepting = false;
+				}else{
+					VPRINTF(VERB_VERBOSE,"\nClient connected (%d open)\n",count);
+				}
+			}
+		}
+
+		for(k=count-1;k>=0;k--){ // backwards, a close moves the last connection (already done) into k
+
+			netConn * c = &conns[k];
+			short revents = (k < nfds-base) ? fds[base+k].revents : 0; // ones accepted just now weren't polled
+
+			if(c->state == NET_READING && (revents & (POLLIN | POLLERR | POLLHUP))){
+
+				got = recv(c->sock,c->req+c->reqLen,NET_REQ_MAX-1-c->reqLen,0);
+				if(got <= 0 && !(got < 0 && NET_WOULDBLOCK())){
+
+					stats.failed++;
+					netClose(conns,k,&count,&stats);
+					continue;
+				}
+				if(got > 0){
+
+					c->reqLen += got;
+					c->req[c->reqLen] = '\0';
+					c->lastActive = now;
+					if(strstr(c->req,"\r\n") != NULL || strchr(c->req,'\n') != NULL || c->reqLen == NET_REQ_MAX-1){ // only the request line matters
+						c->state = NET_WAITING;
+					}
+				}
+			}
+
+			if(c->state == NET_WAITING && stats.budgetUsed + NET_CONN_BUF <= NET_BUDGET){
+
+				c->out = (char *)malloc(NET_CONN_BUF);
+				if(c->out != NULL){
+
+					stats.budgetUsed += NET_CONN_BUF;
+					netStart(c,headNode);
+					netFill(c);
+					c->state = NET_SENDING;
+					c->lastActive = now;
+					revents = POLLOUT; // try right away, the socket is most likely writable
+				}
+			}
+
+			if(c->state == NET_SENDING){
+
+				if((revents & (POLLERR | POLLHUP)) || ((revents & POLLOUT) && !netSend(c,&stats,now))){
+
+					stats.failed++;
+					netClose(conns,k,&count,&stats);
+					continue;
+				}
+				if(c->outHead == c->outTail && c->logNext >= c->logEnd){ // all of it sent
+
+					stats.served++;
+					netClose(conns,k,&count,&stats);
+					continue;
+				}
+			}
+
+			if(c->state != NET_WAITING && now - c->lastActive > NET_IDLE_MS){ // waiting on the budget isn't the client's fault
+
+				VPRINTF(VERB_VERBOSE,"\nClosing idle connection\n");
+				stats.idle++;
+				netClose(conns,k,&count,&stats);
+			}
+		}
+	}
+
+	VPRINTF(VERB_NORMAL,"\nClosing connection...\n");
+	while(count > 0){
+		netClose(conns,count-1,&count,&stats);
+	}
+
+	VPRINTF(VERB_NORMAL,"\nClosing listening socket...\n");
+	CLOSESOCKET(errSock);
+	#if defined(_WIN32)
+		WSACleanup();
+	#endif
+
+	if(serving){
+		VPRINTF(VERB_NORMAL,"\nServed %ld connections (%ld closed idle, %ld failed), %lld bytes sent\n",stats.served,stats.idle,stats.failed,stats.bytes);
+	}
+	VPRINTF(VERB_NORMAL,"Finished.\n");
+
+	free(conns);
+	free(fds);
+
+	retFlag = (stats.served > 0) ? 1 : 0;
+	return retFlag;
+}
+
+
+
+
+static bool self_init(){
+
+
+	logFile = fopen("log.bin","ab+");
+
+
+
+	if(logFile == NULL){
+
+		return false;
+
+	}else{
+
+		errStruct now;
+		clockStamp(&now);
+		logQueueInit();
+		
+
+		if(initErrorStruct(now.errYear,now.errMonth,now.errDoM,now.errDoW)){
+
+			return true;
+
+		}else{
+
+			return false;
+
+		}
+
+		
+		
+
+	}
+
+	
+}
+
+
+
+void done(){
+
+	if(fileOverwrittenFlag == 1){
+
+		displayMessage(8,0);
+	}else{
+
+		displayMessage(7,0);
+	}
+
+	displayMessage(6,0);
+
+	logFlush();
+	aioClose(&logQueue.io);
+	logQueue.ready = false;
+	fclose(logFile);
+
+}
+
+
+int overwriteFile(struct Person ** newHead, char fileName[FILENAME_MAX]){
+
+
+	char tmpName[FILENAME_MAX];
+	bool lazy = (empIndex.lazy != NULL);
+	scanStruct scan;
+	int retFlag = 0;
+
+	TRACE_BEGIN("save");
+	if(shardCount > 0){ // every opened shard rewrites its own file, side by side
+
+		VPRINTF(VERB_NORMAL,"\nOverWrite FileName : %s.*\n",fileName);
+		retFlag = shardParallel(shardCompactTask) ? 1 : 0;
+		if(retFlag == 0){
+			throwError(4,__LINE__);
+		}
+		deleteList(newHead);
+		fileOverwrittenFlag=1;
+		TRACE_END();
+		return retFlag;
+	}
+
+	snprintf(tmpName,sizeof(tmpName),"%s.tmp",fileName);
+
+	FILE * overWrite = fopen(lazy ? tmpName : fileName,"wb"); // a lazy store still reads from fileName while writing
+	VPRINTF(VERB_NORMAL,"\nOverWrite FileName : %s\n",fileName);
+
+
+	if(overWrite != NULL && (*newHead != NULL || lazy) && scanOpen(&scan,*newHead)){
+		fseek(overWrite,0,SEEK_SET);
+		aioStream out;
+		retFlag = streamOpen(&out,overWrite,true) ? 1 : 0;
+		struct Person * walker = (retFlag == 1) ? scanNext(&scan) : NULL; // writes keep going on the live list, the file gets this view
+		//rewind(overWrite);
+
+
+		while(walker != NULL){
+
+			streamWrite(&out,walker,PERSON_DISK_SIZE); // full chunks go to disk while the scan carries on
+			VPRINTF(VERB_VERBOSE,"\nId : %d",walker->id);
+			walker = scanNext(&scan);
+		}
+
+		if(retFlag == 1 && !streamClose(&out)){
+			throwError(4,__LINE__);
+			retFlag = 0;
+		}
+
+		scanClose(&scan);
+		deleteList(newHead);
+		//displayMessage(8);
+		fileOverwrittenFlag=1;
+		//free(*newHead);
+		fclose(overWrite);
+
+		if(lazy && retFlag == 1){
+
+			remove(fileName); // rename() won't replace an existing file on Windows
+			if(rename(tmpName,fileName) != 0){
+				throwError(4,__LINE__);
+				retFlag = 0;
+			}
+
+		}else if(lazy){
+
+			remove(tmpName); // the old file is still good
+		}
+
+	}else{
+
+		if(overWrite != NULL){
+			fclose(overWrite);
+		}
+		throwError(4,__LINE__);
+	}
+
+
+	TRACE_END();
+	return retFlag;
+}
+
+
+
+// Prints information of the structure passed;
+//***************************************************
+void printInfo(struct Person Node){
+
+
+
+	printf("\n*************************************\n*\t\tEmployee Info\t\t*\n******************************************\n");
+#define PERSON_PRINT_NUM(name,type,label) printf("%s %lld\n",label,(long long)Node.name);
+#define PERSON_PRINT_TEXT(name,size,label) printf("%s %.*s\n",label,size,Node.name);
+	PERSON_FIELDS(PERSON_PRINT_NUM,PERSON_PRINT_TEXT)
+#undef PERSON_PRINT_NUM
+#undef PERSON_PRINT_TEXT
+
+
+}
+
+
+
+// Delete the entire list-->Set head=NUll and return head;
+//**********************************************************************
+struct Person * deleteList(struct Person ** entryNode){
+
+
+	if(*entryNode == NULL && empIndex.lazy == NULL && shardCount == 0){ //If head is NULL, throws and error and returns the head..
+
+		throwError(-1,__LINE__);
+	}else{ //delete every node except head.. Set head to NULL (a lazy store's cache and file go with the index)
+
+
+		struct Person* current = *entryNode;
+		struct Person* next;
+		while(current != NULL){
+			
+			next = current->next;
+			free(current);
+			current = next;
+
+		}
+
+		idxClear(&empIndex);
+		shardsClose();
+		zombieNodes = 0;
+
+		changesMade = 1;
+	}
+
+	*entryNode = NULL;
+	return *entryNode;
+}
+
+
+void displayMessage(int msgCode, int val){
+
+
+
+	static int a =0;
+	
+	
+
+	errStruct tempLog;
+
+
+	clockStamp(&tempLog); // the date too, sessionErrorInit's is only right until midnight
+	tempLog.valAssocFlag = 0;
+
+	switch(msgCode){
+
+
+
+		case(1):
+
+			VPRINTF(VERB_NORMAL,"\nValue %d Deleted Sucessfully...",val);
+			tempLog.valAssocFlag = true;
+			tempLog.valueAssoc = val;
+
+			strcpy(tempLog.errMessage,"Value Deleted :");
+			break;
+
+		case(2):
+
+			VPRINTF(VERB_NORMAL,"\nList Sucessfully Deleted..\n");
+			
+			strcpy(tempLog.errMessage,"\nList Sucessfully Deleted..");
+			
+			break;
+
+		case(3):
+
+			VPRINTF(VERB_NORMAL,"\nValue %d not found..\n\n",val);
+			tempLog.valAssocFlag = true;
+			tempLog.valueAssoc = val;
+
+			strcpy(tempLog.errMessage,"Value Not Found :");
+			
+			break;
+
+		case(4):
+
+			VPRINTF(VERB_NORMAL,"\nThe list is empty..\n\n");
+			strcpy(tempLog.errMessage,"The list is empty..");
+			
+			break;
+		case(5):
+
+			VPRINTF(VERB_NORMAL,"\nFile Sucessfully Overwritten\n");
+			strcpy(tempLog.errMessage,"File Sucessfully Overwritten");
+		
+			break;
+
+		case(6):
+
+			VPRINTF(VERB_NORMAL,"\n\nNow exiting the program....\n\n");
+			strcpy(tempLog.errMessage,"Now exiting the program....");
+		
+			break;
+		
+		case(7):
+
+			VPRINTF(VERB_NORMAL,"\n[EXIT MESSAGE] : No changes were made to the file.\n");
+			strcpy(tempLog.errMessage,"[EXIT MESSAGE] : No changes were made to the file.");
+			
+			break;
+
+		case(8):
+
+			VPRINTF(VERB_NORMAL,"\n[EXIT MESSAGE] : Changes were made to the file\n");
+			strcpy(tempLog.errMessage,"[EXIT MESSAGE] : Changes were made to the file");
+		
+			break;
+
+		case(9):
+
+			VPRINTF(VERB_QUIET,"\n[ERR] : Program Failed to Initialize.\n");
+			strcpy(tempLog.errMessage,"[ERR] : Program Failed to Initialize.");
+			break;
+		case(10):
+			VPRINTF(VERB_NORMAL,"\nConfiguring local address...\n");
+			strcpy(tempLog.errMessage,"[MSG] : Configuring local address...");
+			break;
+		case(11):
+			VPRINTF(VERB_NORMAL,"\nCreating socket...\n");
+			strcpy(tempLog.errMessage,"[MSG] : Creating socket...");
+			break;
+		case(12):
+			VPRINTF(VERB_QUIET,"\nSocket Initialization failed (%d)..\n\n",val);
+			tempLog.valAssocFlag = true;
+			tempLog.valueAssoc = val;
+			strcpy(tempLog.errMessage,"Socket Initialization Failed. ");
+			break;
+		case(13):
+			VPRINTF(VERB_NORMAL,"\nBinding socket to local address...\n");
+			strcpy(tempLog.errMessage,"[MSG] : Binding socket to local address...");
+			break;
+		case(14):
+			tempLog.valAssocFlag = true;
+			tempLog.valueAssoc = val;
+			VPRINTF(VERB_NORMAL,"\nSocket Listening on Port %d [Awaiting Connection]",val);
+			strcpy(tempLog.errMessage,"[MSG]: Socket Listening [Awaiting Connection] on Port ");
+			break;
+		case(15):
+			tempLog.valAssocFlag = true;
+			tempLog.valueAssoc = val;
+			VPRINTF(VERB_NORMAL,"\nClient Connected on Port %d\n",val);
+			strcpy(tempLog.errMessage,"[MSG] : Client Connected on Port : ");
+			break;
+			
+	}
+
+	logAppend(&tempLog);
+
+
+}
+
+
+int deleteNode(struct Person ** firstNode, int delVal){
+
+
+	int retFlag = -1;
+	struct idxNode * entry;
+	idxStruct * idx = storeIndex(delVal); // sharded store : the shard delVal routes to
+
+	if(idx == NULL){
+		return retFlag;
+	}
+
+	TRACE_BEGIN("delete");
+	if(*firstNode == NULL && idx->lazy == NULL){ // If head is NULL (Lists Empty), throw an error and return;
+
+		throwError(-1,__LINE__); 
+
+	}else if(idx->lazy != NULL){ // Lazy store : the record is dropped from the index, the save leaves its slot out
+
+		VPRINTF(VERB_VERBOSE,"\nNode %d about to be deleted..\n",delVal);
+
+		entry = idxFind(idx,delVal);
+		if(entry != NULL){
+
+			lazyForget(idx,entry);
+			releaseSlot(idx,entry->slot,false);
+			idxRemove(idx,delVal);
+			retFlag = 1;
+			displayMessage(1,delVal);
+			changesMade = 1;
+
+		}else{
+
+			displayMessage(3,delVal);
+		}
+
+	}else{
+
+		VPRINTF(VERB_VERBOSE,"\nNode %d about to be deleted..\n",delVal);
+
+		reapZombies(firstNode);
+
+		entry = idxFind(&empIndex,delVal); // The index entry knows the node and its predecessor, no walk needed.
+		if(entry != NULL){
+
+			struct Person * temp = entry->rec;
+			struct Person * prev = entry->prev;
+			retFlag = 1;
+
+			releaseSlot(&empIndex,entry->slot,false);
+
+			if(liveSnapshots > 0){ // A snapshot may still be walking it, leave it linked and mark it
+
+				temp->diedEpoch = storeEpoch;
+				zombieNodes++;
+				idxRemove(&empIndex,delVal);
+
+			}else{
+
+				if(prev == NULL){ //If the item is the head, we need to change head to the current head's next
+
+					*firstNode = temp->next;
+
+				}else{
+
+					prev->next = temp->next;
+				}
+
+				if(temp->next != NULL){ // the following node's predecessor changes (zombies aren't indexed)
+
+					entry = idxFind(&empIndex,temp->next->id);
+					if(entry != NULL && entry->rec == temp->next){
+						entry->prev = prev;
+					}
+
+				}else{
+
+					empIndex.tail = prev;
+				}
+
+				idxRemove(&empIndex,delVal);
+				free(temp); //free temp 
+			}
+
+			displayMessage(1,delVal);
+			changesMade = 1;
+			
+			//printf("\n\nValue %d Deleted Successfully..\n\n",delVal);
+		}else{
+
+			displayMessage(3,delVal);
+		}
+
+	}
+	TRACE_END();
+	return retFlag;
+
+}
+
+
+
+int searchList(struct Person * headN,int searchVal, int searchFlag){
+
+	int counter=0,foundFlag=-1;
+	idxStruct * idx = storeIndex(searchVal);
+
+	TRACE_BEGIN("search");
+	if(idx == NULL){
+
+		foundFlag = -2;
+
+	}else if(headN == NULL && idx->lazy == NULL){
+
+		if(searchFlag == 1){
+			throwError(-1,__LINE__);
+		}else{
+			foundFlag = -2;
+		}
+	
+	}else if(idx->lazy != NULL){ // Lazy store : a hit is read in from the file and reported by its slot there (in its shard's file), tombstones count
+
+		struct idxNode * entry = idxFind(idx,searchVal);
+		struct Person * rec = (entry != NULL && searchFlag == 1) ? entryRecord(idx,entry) : NULL;
+
+		if(entry != NULL && searchFlag != 1){
+
+			foundFlag = 1;
+
+		}else if(rec != NULL){
+
+			foundFlag = (entry->slot >= 0) ? (int)entry->slot : SEARCH_UNSAVED;
+			if(foundFlag == SEARCH_UNSAVED){
+				VPRINTF(VERB_NORMAL,"\nFound, not saved yet (no position in the file)...\n");
+			}else{
+				VPRINTF(VERB_NORMAL,"\nFound in slot %d of the data file...\n",foundFlag); // not a list position, deleted slots count too
+			}
+			if(verbosity >= VERB_NORMAL){
+				printInfo(*rec);
+			}
+
+		}else if(searchFlag == 1){
+
+			displayMessage(3,searchVal);
+		}
+
+	}else{
+
+		struct Person *walker = headN;
+		struct Person per;
+		struct idxNode * entry = idxFind(&empIndex,searchVal);
+
+
+			if(entry == NULL){ // Misses never touch the list
+
+				walker = NULL;
+
+			}else if(searchFlag != 1){ // Existence check, the position isn't needed
+
+				foundFlag = 1;
+				walker = NULL;
+			}
+
+			while(walker != NULL){ // Only walked on a hit, to report the position
+				
+				if(walker == entry->rec){
+
+					if(searchFlag == 1){
+						foundFlag=counter;
+						personCopy(&per,walker);
+
+					
+						VPRINTF(VERB_NORMAL,"\nFound at Position %d...\n",counter);
+					
+						if(verbosity >= VERB_NORMAL){
+							printInfo(per);
+						}
+
+					}else{
+
+						foundFlag = 1;
+					}
+	
+					
+					
+					break;
+				}
+			
+				if(walker->diedEpoch == 0){ // zombies kept for snapshots don't have a position
+					counter++;
+				}
+
+				walker = walker->next;
+
+
+			}
+			if(foundFlag == -1 && searchFlag == 1){
+
+				displayMessage(3,searchVal);
+				
+			}
+
+		}
+
+
+
+	TRACE_END();
+	return foundFlag;
+}
+
+int printList(struct Person * headNode,int printFlag){
+
+
+	int itemCounter=0;
+
+	VPRINTF(VERB_NORMAL,"\n\n***********************************************************************\n\n");
+
+	scanStruct scan;
+
+	if(headNode == NULL && empIndex.lazy == NULL && shardCount == 0){
+
+		displayMessage(4,0);
+
+	}else if(scanOpen(&scan,headNode)){
+
+		struct Person *walker = scanNext(&scan);
+	
+		while(walker != NULL){
+
+			if(printFlag == 1){
+
+				if(verbosity >= VERB_NORMAL){
+					printLine(walker);
+				}
+			}
+			
+			walker = scanNext(&scan);
+			itemCounter++;
+		}
+
+		scanClose(&scan);
+	}
+
+	if(printFlag == 1){
+		VPRINTF(VERB_NORMAL,"\n\nTOTAL ITEMS : %d\n\n",itemCounter);
+		VPRINTF(VERB_NORMAL,"\n\nTOTAL SIZE (BYTES) : %lu (%lu KB)\n\n",(unsigned long)(itemCounter*PERSON_DISK_SIZE),(unsigned long)(itemCounter*PERSON_DISK_SIZE)/1024);
+	}
+	return itemCounter;
+}
+
+int insertNode(struct Person ** headNode, struct Person newNode){
+
+	int itemCounter=0;
+	idxStruct * idx = storeIndex(newNode.id); // sharded store : the shard newNode routes to
+	bool duplicate;
+
+	if(idx == NULL){
+		return itemCounter;
+	}
+
+	TRACE_BEGIN("insert");
+	reapZombies(headNode);
+
+	TRACE_BEGIN("dedup");
+	duplicate = (idxFind(idx,newNode.id) != NULL || newNode.id == TOMBSTONE_ID);
+	TRACE_END();
+	
+	if(duplicate){ // ids are unique, the index would lose track of a second node
+
+		VPRINTF(VERB_VERBOSE,"\nValue %d already exists",newNode.id);
+		itemCounter = -1;
+
+	}else if(idx->lazy != NULL){ // Lazy store : kept in memory, outside the cache, until it is saved
+
+		struct Person * rec = (struct Person *)malloc(sizeof(struct Person));
+
+		struct idxNode * entry = (rec != NULL) ? idxInsert(idx,newNode.id,rec,NULL) : NULL;
+
+		if(entry == NULL){
+
+			throwError(3,__LINE__);
+			free(rec);
+
+		}else{
+
+			markDirty(idx,entry);
+			*rec = newNode;
+			rec->next = NULL;
+			rec->bornEpoch = storeEpoch;
+			rec->diedEpoch = 0;
+
+			itemCounter = storeCount();
+			changesMade=1;
+			VPRINTF(VERB_VERBOSE,"\nNew Node Id : %d",rec->id);
+		}
+
+	}else if(*headNode == NULL){ //If head is null, that means the list doesn't exist.. Add the first node (head);
+
+		*headNode = (struct Person *)malloc(sizeof(struct Person));
+
+		if(*headNode == NULL){
+			throwError(3,__LINE__);		
+		}else{
+		
+
+			personCopy(*headNode,&newNode);
+			(*headNode)->next = NULL;
+			(*headNode)->bornEpoch = storeEpoch;
+			(*headNode)->diedEpoch = 0;
+			//*headNode = temp;
+
+			markDirty(&empIndex,idxInsert(&empIndex,(*headNode)->id,*headNode,NULL));
+			empIndex.tail = *headNode;
+
+			itemCounter = empIndex.count;
+			changesMade=1;
+			VPRINTF(VERB_VERBOSE,"\nNew Node Id : %d",(*headNode)->id);
+		}
+	
+	}else{
+
+
+		struct Person *walker = empIndex.tail; // Appends go straight to the tail
+
+		if(walker == NULL){
+			walker = *headNode;
+		}
+		while(walker->next != NULL){
+			walker=walker->next;
+		}
+
+		walker->next = (struct Person *)malloc(sizeof(struct Person));
+
+		if(walker->next == NULL){
+			throwError(3,__LINE__);
+			TRACE_END();
+			return itemCounter;
+		}
+
+		personCopy(walker->next,&newNode);
+	
+		VPRINTF(VERB_VERBOSE,"\nNew Node Id : %d",walker->next->id);
+		walker->next->next = NULL;
+		walker->next->bornEpoch = storeEpoch;
+		walker->next->diedEpoch = 0;
+
+		markDirty(&empIndex,idxInsert(&empIndex,walker->next->id,walker->next,walker));
+		empIndex.tail = walker->next;
+
+		itemCounter = empIndex.count;
+		changesMade=1; // changes were made to our data..
+		
+
+	}
+
+	TRACE_END();
+	return itemCounter;
+}
+
+
+
+// Skip list index over employee ids.
+// Levels are drawn with p = 1/4 from a per-index xorshift state, so a lookup or range seek
+// costs O(log n) and a range scan O(log n + k).
+//***************************************************************************************
+static int idxRandomLevel(idxStruct * idx){
+
+	unsigned int x = idx->seed;
+	int level = 1;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	idx->seed = x;
+
+	while((x & 3) == 0 && level < IDX_MAX_LEVEL){
+		level++;
+		x >>= 2;
+	}
+
+	return level;
+}
+
+
+static struct idxNode * idxLowerBound(idxStruct * idx, int id, struct idxNode ** update){
+
+	struct idxNode * x = idx->header;
+	int i;
+
+	for(i=idx->level-1;i>=0;i--){
+
+		while(x->fwd[i] != NULL && x->fwd[i]->id < id){
+			x = x->fwd[i];
+		}
+		if(update != NULL){
+			update[i] = x;
+		}
+	}
+
+	return x->fwd[0];
+}
+
+
+static struct idxNode * idxFind(idxStruct * idx, int id){
+
+	struct idxNode * x = NULL;
+
+	if(idx->header != NULL && bloomMayContain(idx,id)){
+
+		x = idxLowerBound(idx,id,NULL);
+		if(x != NULL && x->id != id){
+			x = NULL;
+		}
+	}
+
+	return x;
+}
+
+
+static struct idxNode * idxInsert(idxStruct * idx, int id, struct Person * rec, struct Person * prev){
+
+	struct idxNode * update[IDX_MAX_LEVEL];
+	struct idxNode * x;
+	int i,level;
+
+	if(idx->header == NULL){
+
+		idx->header = (struct idxNode *)calloc(1,sizeof(struct idxNode) + IDX_MAX_LEVEL*sizeof(struct idxNode *));
+		if(idx->header == NULL){
+			throwError(3,__LINE__);
+			return NULL;
+		}
+		idx->level = 1;
+		idx->count = 0;
+		idx->seed = 0x9E3779B9u;
+	}
+
+	x = idxLowerBound(idx,id,update);
+	if(x != NULL && x->id == id){
+		return NULL;
+	}
+
+	level = idxRandomLevel(idx);
+	if(level > idx->level){
+
+		for(i=idx->level;i<level;i++){
+			update[i] = idx->header;
+		}
+		idx->level = level;
+	}
+
+	x = (struct idxNode *)malloc(sizeof(struct idxNode) + level*sizeof(struct idxNode *));
+	if(x == NULL){
+		throwError(3,__LINE__);
+		return NULL;
+	}
+
+	x->id = id;
+	x->rec = rec;
+	x->prev = prev;
+	x->slot = -1;
+	x->flags = 0;
+	x->level = level;
+
+	for(i=0;i<level;i++){
+		x->fwd[i] = update[i]->fwd[i];
+		update[i]->fwd[i] = x;
+	}
+
+	idx->count++;
+	bloomAdd(idx,id);
+	return x;
+}
+
+
+static bool idxRemove(idxStruct * idx, int id){
+
+	struct idxNode * update[IDX_MAX_LEVEL];
+	struct idxNode * x;
+	int i;
+
+	if(idx->header == NULL){
+		return false;
+	}
+
+	x = idxLowerBound(idx,id,update);
+	if(x == NULL || x->id != id){
+		return false;
+	}
+
+	for(i=0;i<x->level;i++){
+		update[i]->fwd[i] = x->fwd[i];
+	}
+	while(idx->level > 1 && idx->header->fwd[idx->level-1] == NULL){
+		idx->level--;
+	}
+
+	free(x);
+	idx->count--;
+
+	idx->bloomStale++;
+	if(idx->bloomStale > idx->count/4 + 64){ // amortised : a quarter of the ids went since the last rebuild
+		bloomGrow(idx);
+	}
+	return true;
+}
+
+
+static void idxClear(idxStruct * idx){
+
+	struct idxNode * x;
+	struct idxNode * next;
+
+	if(idx->lazy != NULL){
+		lazyClose(idx);
+	}
+
+	if(idx->header != NULL){
+
+		x = idx->header->fwd[0];
+		while(x != NULL){
+			next = x->fwd[0];
+			free(x);
+			x = next;
+		}
+		free(idx->header);
+	}
+
+	if(idx->bloom != NULL && idx->bloomSkips > 0){
+		VPRINTF(VERB_VERBOSE,"\nId filter : %ld lookups answered without the index\n",idx->bloomSkips);
+	}
+
+	free(idx->freeSlots);
+	free(idx->dirtyIds);
+	free(idx->bloom);
+	memset(idx,0,sizeof(idxStruct));
+}
+
+
+static unsigned long long bloomHash(int id){
+
+	unsigned long long h = (unsigned long long)(unsigned int)id + 0x9E3779B97F4A7C15ull; // splitmix64 finaliser
+
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+	return h ^ (h >> 31);
+}
+
+
+// The low bits pick the block, then each probe takes 9 bits (a bit number inside the block) from the top.
+static bool bloomMayContain(idxStruct * idx, int id){
+
+	unsigned long long h,*block;
+	int i,bit;
+
+	if(idx->bloom == NULL){
+		return true;
+	}
+
+	h = bloomHash(id);
+	block = idx->bloom + (h & (idx->bloomBlocks-1))*BLOOM_BLOCK_WORDS;
+
+	for(i=0;i<BLOOM_PROBES;i++){
+
+		bit = (int)((h >> (63 - 9*(i+1))) & 511);
+		if((block[bit >> 6] & (1ull << (bit & 63))) == 0){
+			idx->bloomSkips++;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static void bloomAdd(idxStruct * idx, int id){
+
+	unsigned long long h,*block;
+	int i,bit;
+
+	if(idx->bloom == NULL || (unsigned long)idx->bloomKeys >= idx->bloomBlocks*BLOOM_BLOCK_WORDS*64/BLOOM_BITS_PER_KEY){
+		bloomGrow(idx); // the index already holds id, so the rebuild covers it
+		return;
+	}
+
+	h = bloomHash(id);
+	block = idx->bloom + (h & (idx->bloomBlocks-1))*BLOOM_BLOCK_WORDS;
+
+	for(i=0;i<BLOOM_PROBES;i++){
+
+		bit = (int)((h >> (63 - 9*(i+1))) & 511);
+		block[bit >> 6] |= 1ull << (bit & 63);
+	}
+
+	idx->bloomKeys++;
+}
+
+
+static void bloomGrow(idxStruct * idx){
+
+	if(!idx->bloomFailed){ // a failed allocation isn't retried on every insert, only by the next explicit rebuild
+		bloomRebuild(idx);
+	}
+}
+
+
+// Sized for twice the current ids so a growing list rebuilds O(log n) times in all.
+// If the allocation fails the filter is dropped and every lookup goes to the index.
+static void bloomRebuild(idxStruct * idx){
+
+	unsigned long blocks = BLOOM_MIN_BLOCKS;
+	unsigned long want = ((unsigned long)idx->count*2*BLOOM_BITS_PER_KEY)/(BLOOM_BLOCK_WORDS*64) + 1;
+	struct idxNode * x;
+
+	while(blocks < want){
+		blocks <<= 1;
+	}
+
+	if(idx->bloom == NULL || idx->bloomBlocks != blocks){
+
+		free(idx->bloom);
+		idx->bloom = (unsigned long long *)malloc(blocks*BLOOM_BLOCK_WORDS*sizeof(unsigned long long));
+		idx->bloomBlocks = (idx->bloom != NULL) ? blocks : 0;
+	}
+
+	idx->bloomKeys = 0;
+	idx->bloomStale = 0;
+	idx->bloomFailed = (idx->bloom == NULL);
+
+	if(idx->bloom == NULL){
+		return;
+	}
+
+	memset(idx->bloom,0,blocks*BLOOM_BLOCK_WORDS*sizeof(unsigned long long));
+
+	for(x = (idx->header != NULL) ? idx->header->fwd[0] : NULL; x != NULL; x = x->fwd[0]){
+		bloomAdd(idx,x->id);
+	}
+}
+
+
+static idxCursor idxSeek(idxStruct * idx, int loId, int hiId){
+
+	idxCursor cursor;
+
+	cursor.idx = idx;
+	cursor.node = (idx->header != NULL) ? idxLowerBound(idx,loId,NULL) : NULL;
+	cursor.hiId = hiId;
+
+	return cursor;
+}
+
+
+static struct Person * idxNext(idxCursor * cursor){
+
+	struct Person * rec = NULL;
+
+	if(cursor->node != NULL && cursor->node->id <= cursor->hiId){
+
+		rec = entryRecord(cursor->idx,cursor->node);
+		cursor->node = cursor->node->fwd[0];
+	}
+
+	return rec;
+}
+
+
+// Snapshots
+// Taking one closes the current epoch: everything inserted or deleted afterwards carries a
+// newer epoch, so visibility is a two compare check per node. Deleted nodes are only unlinked
+// once no snapshot is left, in a single sweep by the next insert or delete.
+//***************************************************************************************
+snapStruct takeSnapshot(struct Person * headNode){
+
+	snapStruct snap;
+
+	snap.head = headNode;
+	snap.tail = (headNode != NULL) ? empIndex.tail : NULL;
+	snap.epoch = storeEpoch++;
+	liveSnapshots++;
+
+	return snap;
+}
+
+
+struct Person * snapNext(snapStruct * snap, struct Person * node){
+
+	struct Person * p;
+
+	if(node == NULL){
+		p = snap->head;
+	}else{
+		p = (node == snap->tail) ? NULL : node->next;
+	}
+
+	while(p != NULL && !SNAP_VISIBLE(p,snap->epoch)){
+		p = (p == snap->tail) ? NULL : p->next;
+	}
+
+	return p;
+}
+
+
+void releaseSnapshot(snapStruct * snap){
+
+	snap->head = NULL;
+	snap->tail = NULL;
+	liveSnapshots--;
+}
+
+
+// Called by the writers, which hold the real head pointer, before they change the list.
+static void reapZombies(struct Person ** headNode){
+
+	struct Person * prev = NULL;
+	struct Person * walker;
+	struct Person * next;
+	struct idxNode * entry;
+
+	if(liveSnapshots > 0 || zombieNodes == 0){
+		return;
+	}
+
+	walker = *headNode;
+	while(walker != NULL){ // Sweep out the nodes deleted while snapshots were held
+
+		next = walker->next;
+		if(walker->diedEpoch != 0){
+
+			if(prev == NULL){
+				*headNode = next;
+			}else{
+				prev->next = next;
+			}
+			if(next == NULL){
+				empIndex.tail = prev;
+			}
+			free(walker);
+			zombieNodes--;
+
+		}else{
+
+			entry = idxFind(&empIndex,walker->id);
+			if(entry != NULL && entry->rec == walker){
+				entry->prev = prev;
+			}
+			prev = walker;
+		}
+		walker = next;
+	}
+}
+
+
+// Lazy store and store scans
+//***************************************************************************************
+static void lruUnlink(lazyStruct * lazy, int k){
+
+	struct cacheSlot * c = &lazy->slots[k];
+
+	if(c->newer >= 0){
+		lazy->slots[c->newer].older = c->older;
+	}else{
+		lazy->newest = c->older;
+	}
+	if(c->older >= 0){
+		lazy->slots[c->older].newer = c->newer;
+	}else{
+		lazy->oldest = c->newer;
+	}
+	c->newer = c->older = -1;
+}
+
+
+static void lruPush(lazyStruct * lazy, int k, bool newest){
+
+	struct cacheSlot * c = &lazy->slots[k];
+
+	if(lazy->newest < 0){
+
+		lazy->newest = lazy->oldest = k;
+
+	}else if(newest){
+
+		c->older = lazy->newest;
+		lazy->slots[lazy->newest].newer = k;
+		lazy->newest = k;
+
+	}else{ // free slots go to the old end so they're reused first
+
+		c->newer = lazy->oldest;
+		lazy->slots[lazy->oldest].older = k;
+		lazy->oldest = k;
+	}
+}
+
+
+static bool lazyOpen(idxStruct * idx, const char * path, int cacheSize){
+
+	lazyStruct * lazy = (lazyStruct *)calloc(1,sizeof(lazyStruct));
+	aioStream in;
+	char * chunk;
+	size_t got,i;
+	long slot = 0,dupes = 0;
+	struct idxNode * entry;
+	int id;
+	bool streaming = false,missing = false;
+
+	if(lazy != NULL){
+		lazy->slots = (struct cacheSlot *)malloc(cacheSize*sizeof(struct cacheSlot));
+		lazy->file = fopen(path,"rb");
+		missing = (lazy->file == NULL && errno == ENOENT); // nothing saved to it yet : an empty index, the save creates the file
+	}
+
+	if(lazy != NULL && lazy->slots != NULL && lazy->file != NULL){
+		streaming = streamOpen(&in,lazy->file,false);
+	}
+
+	if(!streaming && !(missing && lazy->slots != NULL)){
+
+		if(lazy != NULL){
+			if(lazy->file != NULL){
+				fclose(lazy->file);
+			}
+			free(lazy->slots);
+		}
+		free(lazy);
+		return false;
+	}
+
+	TRACE_BEGIN("load");
+	lazy->capacity = cacheSize;
+	lazy->newest = lazy->oldest = -1;
+
+	while(streaming && (chunk = streamRead(&in,&got)) != NULL){ // Only the id of each record is looked at, the next chunks are already on their way
+
+		for(i=0;i+PERSON_DISK_SIZE<=got;i+=PERSON_DISK_SIZE,slot++){
+
+			memcpy(&id,chunk + i + offsetof(struct Person,id),sizeof(int));
+			if(id == TOMBSTONE_ID){
+				releaseSlot(idx,slot,true);
+				continue;
+			}
+			entry = idxInsert(idx,id,NULL,NULL);
+			if(entry != NULL){
+				entry->slot = slot;
+			}else{
+				dupes++; // first copy of an id wins, same as the full loader
+				releaseSlot(idx,slot,false);
+			}
+		}
+	}
+
+	if(streaming && !streamClose(&in)){ // a read failed part way, the ids after it were never seen
+
+		idxClear(idx);
+		fclose(lazy->file);
+		free(lazy->slots);
+		free(lazy);
+		TRACE_END();
+		return false;
+	}
+	idx->slotCount = slot;
+	if(idx->bloomFailed){
+		bloomRebuild(idx); // one more try now the load is done
+	}
+
+	idx->lazy = lazy;
+
+	VPRINTF(VERB_NORMAL,"\nIndexed %d records (%ld duplicates skipped), cache holds %d\n",idx->count,dupes,cacheSize);
+	TRACE_END();
+	return true;
+}
+
+
+static struct Person * entryRecord(idxStruct * idx, struct idxNode * entry){
+
+	lazyStruct * lazy = idx->lazy;
+	struct cacheSlot * c;
+	int k;
+
+	if(entry->rec != NULL){
+
+		if((entry->flags & IDX_CACHED) && lazy != NULL){
+
+			k = (int)((struct cacheSlot *)entry->rec - lazy->slots);
+			if(lazy->newest != k){
+				lruUnlink(lazy,k);
+				lruPush(lazy,k,true);
+			}
+			lazy->hits++;
+		}
+		return entry->rec;
+	}
+
+	if(lazy == NULL || entry->slot < 0){
+		return NULL;
+	}
+
+	if(lazy->used < lazy->capacity){ // take a fresh slot, or evict the least recently used record
+
+		k = lazy->used++;
+
+	}else{
+
+		k = lazy->oldest;
+		lruUnlink(lazy,k);
+		if(lazy->slots[k].owner != NULL){
+			lazy->slots[k].owner->rec = NULL;
+			lazy->slots[k].owner->flags &= ~IDX_CACHED;
+		}
+	}
+
+	c = &lazy->slots[k];
+	c->owner = NULL;
+	c->newer = c->older = -1;
+
+	if(fseek(lazy->file,entry->slot*(long)PERSON_DISK_SIZE,SEEK_SET) != 0 || fread(&c->rec,PERSON_DISK_SIZE,1,lazy->file) != 1){
+
+		lruPush(lazy,k,false);
+		throwError(5,__LINE__);
+		return NULL;
+	}
+
+	c->rec.next = NULL;
+	c->rec.bornEpoch = 0;
+	c->rec.diedEpoch = 0;
+	c->owner = entry;
+	entry->rec = &c->rec;
+	entry->flags |= IDX_CACHED;
+	lruPush(lazy,k,true);
+	lazy->faults++;
+
+	return entry->rec;
+}
+
+
+static void lazyForget(idxStruct * idx, struct idxNode * entry){
+
+	lazyStruct * lazy = idx->lazy;
+	int k;
+
+	if(lazy == NULL || entry->rec == NULL){
+		return;
+	}
+
+	if(entry->flags & IDX_CACHED){
+
+		k = (int)((struct cacheSlot *)entry->rec - lazy->slots);
+		lazy->slots[k].owner = NULL;
+		lruUnlink(lazy,k);
+		lruPush(lazy,k,false);
+
+	}else{
+
+		free(entry->rec); // unsaved record
+	}
+
+	entry->rec = NULL;
+	entry->flags &= ~IDX_CACHED;
+}
+
+
+static void lazyClose(idxStruct * idx){
+
+	lazyStruct * lazy = idx->lazy;
+	struct idxNode * x;
+
+	for(x=(idx->header != NULL ? idx->header->fwd[0] : NULL);x != NULL;x=x->fwd[0]){
+		lazyForget(idx,x);
+	}
+
+	VPRINTF(VERB_VERBOSE,"\nRecord cache : %ld hits, %ld faults\n",lazy->hits,lazy->faults);
+
+	if(lazy->file != NULL){
+		fclose(lazy->file);
+	}
+	free(lazy->slots);
+	free(lazy);
+	idx->lazy = NULL;
+}
+
+
+static void scanStart(scanStruct * scan, idxStruct * idx){
+
+	scan->idx = idx;
+	scan->file = idx->lazy->file; // shared with the cache, so every read seeks first
+	scan->bufRecs = scan->bufPos = scan->slot = 0;
+	scan->pending = NULL;
+
+	if(scan->file == NULL && idx->header != NULL){ // no data file yet, only unsaved records
+		scan->pending = idx->header->fwd[0];
+	}
+}
+
+
+static bool scanOpenIndex(scanStruct * scan, idxStruct * idx){
+
+	memset(scan,0,sizeof(scanStruct));
+	scan->count = idx->count;
+	scan->shard = -1;
+
+	scan->buf = (char *)malloc(IO_BUF_SIZE);
+	if(scan->buf == NULL){
+		throwError(3,__LINE__);
+		return false;
+	}
+
+	scanStart(scan,idx);
+	return true;
+}
+
+
+static bool scanOpen(scanStruct * scan, struct Person * headNode){
+
+	if(shardCount > 0){ // every shard, one after the other
+
+		if(!shardOpenAll()){
+			throwError(2,__LINE__);
+			return false;
+		}
+		if(!scanOpenIndex(scan,&shards[0].idx)){
+			return false;
+		}
+		scan->count = storeCount();
+		scan->shard = 1;
+		return true;
+	}
+
+	if(empIndex.lazy != NULL){
+		return scanOpenIndex(scan,&empIndex);
+	}
+
+	memset(scan,0,sizeof(scanStruct));
+	scan->count = empIndex.count;
+	scan->shard = -1;
+
+	scan->snap = (snapStruct *)malloc(sizeof(snapStruct));
+	if(scan->snap == NULL){
+		throwError(3,__LINE__);
+		return false;
+	}
+	*scan->snap = takeSnapshot(headNode);
+	return true;
+}
+
+
+static struct Person * scanNext(scanStruct * scan){
+
+	long perRead = IO_BUF_SIZE / PERSON_DISK_SIZE;
+	struct idxNode * entry;
+	const char * raw;
+	int id;
+
+	if(scan->snap != NULL){
+
+		scan->cur = snapNext(scan->snap,scan->cur);
+		return scan->cur;
+	}
+
+	while(scan->file != NULL){ // records on disk, in file order
+
+		if(scan->bufPos == scan->bufRecs){
+
+			if(fseek(scan->file,scan->slot*(long)PERSON_DISK_SIZE,SEEK_SET) == 0){
+				scan->bufRecs = (long)fread(scan->buf,PERSON_DISK_SIZE,perRead,scan->file);
+			}else{
+				scan->bufRecs = 0;
+			}
+			scan->bufPos = 0;
+
+			if(scan->bufRecs == 0){
+				scan->file = NULL;
+				scan->pending = (scan->idx->header != NULL) ? scan->idx->header->fwd[0] : NULL;
+				break;
+			}
+		}
+
+		raw = scan->buf + scan->bufPos*PERSON_DISK_SIZE;
+		scan->bufPos++;
+		scan->slot++;
+
+		memcpy(&id,raw + offsetof(struct Person,id),sizeof(int));
+		entry = idxFind(scan->idx,id);
+
+		if(entry != NULL && entry->slot == scan->slot-1){
+
+			memcpy(&scan->rec,raw,PERSON_DISK_SIZE);
+			scan->rec.next = NULL;
+			return &scan->rec;
+		}
+	}
+
+	while(scan->pending != NULL){ // then the records that aren't on disk yet
+
+		entry = scan->pending;
+		scan->pending = entry->fwd[0];
+		if(entry->slot < 0 && entry->rec != NULL){
+			return entry->rec;
+		}
+	}
+
+	if(scan->shard >= 0 && scan->shard < shardCount){ // on to the next shard
+
+		scanStart(scan,&shards[scan->shard++].idx);
+		return scanNext(scan);
+	}
+
+	return NULL;
+}
+
+
+static void scanClose(scanStruct * scan){
+
+	if(scan->snap != NULL){
+		releaseSnapshot(scan->snap);
+		free(scan->snap);
+	}
+	free(scan->buf);
+	memset(scan,0,sizeof(scanStruct));
+}
+
+
+// Sharded store
+// The shard of an id is picked by a multiplicative hash, so consecutive ids spread out. A shard
+// is opened (its ids read) the first time something routes to it. Work on the whole store
+// (opening every shard for a scan, saving, compacting) runs one thread per shard.
+//***************************************************************************************
+static int shardOf(int id){
+
+	return (int)((((unsigned int)id * 2654435761u) >> 8) % (unsigned int)shardCount);
+}
+
+
+static bool shardsInit(const char * base, int count, int cacheSize){
+
+	int k;
+
+	shards = (shardStruct *)calloc(count,sizeof(shardStruct));
+	if(shards == NULL){
+		throwError(3,__LINE__);
+		return false;
+	}
+
+	for(k=0;k<count;k++){
+		snprintf(shards[k].path,sizeof(shards[k].path),"%s.%d",base,k);
+	}
+
+	shardCount = count;
+	shardCache = cacheSize;
+	return true;
+}
+
+
+static bool shardOpen(shardStruct * shard){
+
+	if(!shard->opened){ // a shard nothing was saved to yet has no file, lookups leave it that way
+
+		shard->opened = lazyOpen(&shard->idx,shard->path,shardCache);
+	}
+
+	return shard->opened;
+}
+
+
+static void * shardOpenTask(void * arg){
+
+	shardStruct * shard = (shardStruct *)arg;
+
+	TRACE_BEGIN("open shard");
+	shard->result = shardOpen(shard) ? 1 : 0;
+	TRACE_END();
+	return NULL;
+}
+
+
+static void * shardSaveTask(void * arg){
+
+	shardStruct * shard = (shardStruct *)arg;
+
+	shard->written = shard->punched = 0;
+	TRACE_BEGIN("save shard");
+	shard->result = shard->opened ? saveIndex(&shard->idx,shard->path,&shard->written,&shard->punched) : 1; // never opened, nothing changed
+	TRACE_END();
+	return NULL;
+}
+
+
+static void * shardCompactTask(void * arg){
+
+	shardStruct * shard = (shardStruct *)arg;
+
+	shard->written = 0;
+	TRACE_BEGIN("compact shard");
+	shard->result = shard->opened ? compactIndex(&shard->idx,shard->path,&shard->written) : 1;
+	TRACE_END();
+	return NULL;
+}
+
+
+// Runs task on every shard, one thread each, and waits for all of them.
+static bool shardParallel(void * (*task)(void *)){
+
+	int k;
+	bool retFlag = true;
+
+	#if !defined(_WIN32)
+	{
+		pthread_t tid[SHARD_MAX];
+		bool started[SHARD_MAX];
+
+		for(k=0;k<shardCount;k++){
+			started[k] = (pthread_create(&tid[k],NULL,task,&shards[k]) == 0);
+		}
+		for(k=0;k<shardCount;k++){
+			if(started[k]){
+				pthread_join(tid[k],NULL);
+			}else{
+				task(&shards[k]); // couldn't get a thread, do it here
+			}
+		}
+	}
+	#else
+	for(k=0;k<shardCount;k++){
+		task(&shards[k]);
+	}
+	#endif
+
+	for(k=0;k<shardCount;k++){
+		if(shards[k].result == 0){
+			retFlag = false;
+		}
+	}
+
+	return retFlag;
+}
+
+
+static bool shardOpenAll(){
+
+	int k;
+
+	for(k=0;k<shardCount;k++){
+		if(!shards[k].opened){
+			return shardParallel(shardOpenTask);
+		}
+	}
+
+	return true;
+}
+
+
+static void shardsClose(){
+
+	int k;
+
+	for(k=0;k<shardCount;k++){ // the files stay, a later lookup opens them again
+		idxClear(&shards[k].idx);
+		shards[k].opened = false;
+	}
+}
+
+
+static idxStruct * storeIndex(int id){
+
+	shardStruct * shard;
+
+	if(shardCount == 0){
+		return &empIndex;
+	}
+
+	shard = &shards[shardOf(id)];
+	if(!shardOpen(shard)){
+		throwError(2,__LINE__);
+		return NULL;
+	}
+
+	return &shard->idx;
+}
+
+
+static int storeCount(){
+
+	int k,count = empIndex.count;
+
+	for(k=0;k<shardCount;k++){
+		count += shards[k].idx.count;
+	}
+
+	return count;
+}
+
+
+// Writes the index's live records to fileName.tmp and renames it over fileName. The index is
+// cleared first (its file has to be closed for the rename on Windows), as deleteList would.
+static int compactIndex(idxStruct * idx, const char * fileName, long * written){
+
+	char tmpName[FILENAME_MAX];
+	FILE * out;
+	aioStream stream;
+	scanStruct scan;
+	struct Person * walker;
+	int retFlag = 0;
+
+	*written = 0;
+	snprintf(tmpName,sizeof(tmpName),"%s.tmp",fileName);
+
+	out = fopen(tmpName,"wb");
+	if(out != NULL && scanOpenIndex(&scan,idx)){
+
+		if(streamOpen(&stream,out,true)){
+
+			retFlag = 1;
+			while((walker = scanNext(&scan)) != NULL){
+
+				if(!streamWrite(&stream,walker,PERSON_DISK_SIZE)){
+					retFlag = 0;
+					break;
+				}
+				(*written)++;
+			}
+			if(!streamClose(&stream)){
+				retFlag = 0;
+			}
+		}
+		scanClose(&scan);
+	}
+
+	if(out != NULL && fclose(out) != 0){
+		retFlag = 0;
+	}
+
+	idxClear(idx);
+
+	if(retFlag == 1){
+
+		remove(fileName); // rename() won't replace an existing file on Windows
+		if(rename(tmpName,fileName) != 0){
+			retFlag = 0;
+		}
+
+	}else{
+
+		remove(tmpName); // the old file is left as it was
+	}
+
+	return retFlag;
+}
+
+
+// Incremental save
+// Inserts queue their id as dirty and deletes put their slot in the free map, so a save
+// touches one slot per change : tombstones for freed slots, in-place writes for dirty
+// records (reusing freed slots first, then appending). Cost follows the edit, not the roster.
+//***************************************************************************************
+static void markDirty(idxStruct * idx, struct idxNode * entry){
+
+	int * grown;
+
+	if(entry == NULL || (entry->flags & IDX_DIRTY)){
+		return;
+	}
+
+	if(idx->dirtyCount == idx->dirtyCap){
+
+		grown = (int *)realloc(idx->dirtyIds,(idx->dirtyCap ? idx->dirtyCap*2 : 64)*sizeof(int));
+		if(grown == NULL){
+			throwError(3,__LINE__);
+			return;
+		}
+		idx->dirtyIds = grown;
+		idx->dirtyCap = idx->dirtyCap ? idx->dirtyCap*2 : 64;
+	}
+
+	idx->dirtyIds[idx->dirtyCount++] = entry->id;
+	entry->flags |= IDX_DIRTY;
+}
+
+
+static void releaseSlot(idxStruct * idx, long slot, bool punched){
+
+	struct freeSlot * grown;
+
+	if(slot < 0){ // never saved, nothing on disk to reclaim
+		return;
+	}
+
+	if(idx->freeCount == idx->freeCap){
+
+		grown = (struct freeSlot *)realloc(idx->freeSlots,(idx->freeCap ? idx->freeCap*2 : 64)*sizeof(struct freeSlot));
+		if(grown == NULL){
+			throwError(3,__LINE__);
+			return;
+		}
+		idx->freeSlots = grown;
+		idx->freeCap = idx->freeCap ? idx->freeCap*2 : 64;
+	}
+
+	idx->freeSlots[idx->freeCount].slot = slot;
+	idx->freeSlots[idx->freeCount].punched = punched;
+	idx->freeCount++;
+}
+
+
+static int saveIndex(idxStruct * idx, const char * fileName, long * written, long * punched){
+
+	FILE * out = fopen(fileName,"rb+");
+	char tomb[sizeof(struct Person)];
+	struct idxNode * entry;
+	struct Person * rec;
+	slotWriter w;
+	int tombId = TOMBSTONE_ID,retFlag = 0,i;
+
+	*written = *punched = 0;
+
+	if(out == NULL){
+		out = fopen(fileName,"wb+"); // roster built from an import, no data file yet
+	}
+
+	if(out == NULL){
+		return retFlag;
+	}
+
+	if(idx->lazy != NULL && idx->lazy->file == NULL){ // its first save : the cache reads back from the file made just now
+
+		idx->lazy->file = fopen(fileName,"rb");
+		if(idx->lazy->file == NULL){
+			fclose(out);
+			return retFlag;
+		}
+	}
+
+	if(!slotWriterOpen(&w,out)){ // up to AIO_DEPTH slot writes in flight, the disk sees them all at once
+		fclose(out);
+		return retFlag;
+	}
+
+	retFlag = 1;
+
+	for(i=0;i<idx->dirtyCount;i++){ // new and changed records, into a free slot or onto the end
+
+		entry = idxFind(idx,idx->dirtyIds[i]);
+		if(entry == NULL || !(entry->flags & IDX_DIRTY)){
+			continue; // deleted since, or already written
+		}
+
+		rec = entryRecord(idx,entry);
+		if(entry->slot < 0){
+
+			if(idx->freeCount > 0){
+				entry->slot = idx->freeSlots[--idx->freeCount].slot;
+			}else{
+				entry->slot = idx->slotCount++;
+			}
+		}
+
+		if(rec == NULL || !slotWrite(&w,entry->slot,rec)){
+
+			retFlag = 0;
+			break;
+		}
+		VPRINTF(VERB_VERBOSE,"\nId : %d (slot %ld)",rec->id,entry->slot);
+
+		entry->flags &= ~IDX_DIRTY;
+		if(idx->lazy != NULL && !(entry->flags & IDX_CACHED)){
+			lazyForget(idx,entry); // it's on disk now, so it can be read back through the cache
+		}
+		(*written)++;
+	}
+
+	memset(tomb,0,sizeof(tomb));
+	memcpy(tomb + offsetof(struct Person,id),&tombId,sizeof(int));
+
+	for(i=0;i<idx->freeCount && retFlag == 1;i++){ // punch out the slots freed since the last save
+
+		if(idx->freeSlots[i].punched){
+			continue;
+		}
+		if(!slotWrite(&w,idx->freeSlots[i].slot,tomb)){
+
+			retFlag = 0;
+			break;
+		}
+		idx->freeSlots[i].punched = true;
+		(*punched)++;
+	}
+
+	if(!slotWriterClose(&w)){
+		retFlag = 0;
+	}
+
+	if(fclose(out) != 0){
+		retFlag = 0;
+	}
+
+	if(retFlag == 1){
+		idx->dirtyCount = 0;
+	}
+
+	return retFlag;
+}
+
+
+int saveChanges(struct Person ** newHead, char * fileName){
+
+	long written = 0,punched = 0;
+	int retFlag,k;
+
+	TRACE_BEGIN("save");
+	VPRINTF(VERB_NORMAL,"\nSaving changes to : %s%s\n",fileName,shardCount > 0 ? ".*" : "");
+
+	if(shardCount > 0){ // each shard has its own file, so they're written side by side
+
+		retFlag = shardParallel(shardSaveTask) ? 1 : 0;
+		for(k=0;k<shardCount;k++){
+			written += shards[k].written;
+			punched += shards[k].punched;
+		}
+
+	}else{
+
+		retFlag = saveIndex(&empIndex,fileName,&written,&punched);
+	}
+
+	if(retFlag == 1){
+
+		VPRINTF(VERB_NORMAL,"\nSaved %ld records, punched out %ld deleted slots\n",written,punched);
+		deleteList(newHead); // same contract as overwriteFile
+		fileOverwrittenFlag=1;
+
+	}else{
+
+		throwError(4,__LINE__);
+	}
+
+	TRACE_END();
+	return retFlag;
+}
+
+
+// Next record of the merged cursors in id order : the one whose next entry has the lowest id.
+static struct Person * rangeNext(idxCursor * cursors, int count){
+
+	int k,best = -1;
+
+	for(k=0;k<count;k++){
+
+		if(cursors[k].node != NULL && (best < 0 || cursors[k].node->id < cursors[best].node->id)){
+			best = k;
+		}
+	}
+
+	return (best >= 0) ? idxNext(&cursors[best]) : NULL;
+}
+
+
+// Prints a page of employees in id order. When the page fills up before the range
+// ends, prints the id to pass as loId to get the next page.
+//***************************************************************************************
+int printRange(int loId, int hiId, int limit){
+
+	int printed = 0,k,cursorCount = 1;
+	struct Person * walker;
+	idxCursor cursors[SHARD_MAX];
+
+	if(shardCount > 0){ // one cursor per shard, merged by id
+
+		if(!shardOpenAll()){
+			throwError(2,__LINE__);
+			return printed;
+		}
+		for(k=0;k<shardCount;k++){
+			cursors[k] = idxSeek(&shards[k].idx,loId,hiId);
+		}
+		cursorCount = shardCount;
+
+	}else{
+
+		cursors[0] = idxSeek(&empIndex,loId,hiId);
+	}
+
+	VPRINTF(VERB_NORMAL,"\n\n***********************************************************************\n\n");
+
+	while((limit < 0 || printed < limit) && (walker = rangeNext(cursors,cursorCount)) != NULL){
+
+		if(verbosity >= VERB_NORMAL){
+			printLine(walker);
+		}
+		printed++;
+	}
+
+	VPRINTF(VERB_NORMAL,"\n\nITEMS IN RANGE [%d - %d] : %d\n",loId,hiId,printed);
+
+	if((walker = rangeNext(cursors,cursorCount)) != NULL){
+		VPRINTF(VERB_NORMAL,"MORE AFTER THIS PAGE, NEXT ID : %d\n",walker->id);
+	}
+
+	return printed;
+}
+
+
+// Aggregation engine
+// The list is walked once to gather two flat columns (group number, field value); the
+// reduction then runs over those arrays, split across threads for large rosters.
+// Each thread reduces its slice into private per-group totals which are merged at the end.
+//***************************************************************************************
+typedef struct aggTaskStruct{
+
+	const unsigned short * grp; // group number per row, NULL when ungrouped
+	const long long * val;
+	long lo,hi;
+	long count[AGG_MAX_GROUPS];
+	long long sum[AGG_MAX_GROUPS];
+	long long min[AGG_MAX_GROUPS];
+	long long max[AGG_MAX_GROUPS];
+
+}aggTask;
+
+
+static void * aggReduce(void * arg){
+
+	aggTask * task = (aggTask *)arg;
+	const long long * val = task->val;
+	long i;
+	int g;
+
+	for(g=0;g<AGG_MAX_GROUPS;g++){
+		task->count[g] = 0;
+		task->sum[g] = 0;
+		task->min[g] = LLONG_MAX;
+		task->max[g] = LLONG_MIN;
+	}
+
+	if(task->grp == NULL){ // Plain reduction, no scatter, so the compiler can vectorize it
+
+		long long s = 0, mn = LLONG_MAX, mx = LLONG_MIN;
+
+		for(i=task->lo;i<task->hi;i++){
+			s += val[i];
+			mn = val[i] < mn ? val[i] : mn;
+			mx = val[i] > mx ? val[i] : mx;
+		}
+		task->count[0] = task->hi - task->lo;
+		task->sum[0] = s;
+		task->min[0] = mn;
+		task->max[0] = mx;
+
+	}else{
+
+		for(i=task->lo;i<task->hi;i++){
+			g = task->grp[i];
+			task->count[g]++;
+			task->sum[g] += val[i];
+			task->min[g] = val[i] < task->min[g] ? val[i] : task->min[g];
+			task->max[g] = val[i] > task->max[g] ? val[i] : task->max[g];
+		}
+	}
+
+	return NULL;
+}
+
+
+static bool aggParseQuery(const char * query, aggStruct * agg){
+
+	const char * p = query;
+	const char * eq;
+	const char * end;
+	int keyLen,valLen;
+	bool retFlag = true;
+
+	agg->groupBy = AGG_GROUP_NONE;
+	agg->bandWidth = 10;
+	agg->field = PF_age;
+
+	while(*p != '\0' && retFlag){
+
+		end = strchr(p,'&');
+		if(end == NULL){
+			end = p + strlen(p);
+		}
+		eq = memchr(p,'=',end-p);
+
+		if(eq == NULL){
+
+			retFlag = false;
+
+		}else{
+
+			keyLen = eq - p;
+			valLen = end - (eq+1);
+			eq++;
+
+			if(keyLen == 5 && strncmp(p,"group",5) == 0){
+
+				if(valLen == 4 && strncmp(eq,"none",4) == 0){
+					agg->groupBy = AGG_GROUP_NONE;
+				}else if(valLen == 3 && strncmp(eq,"age",3) == 0){
+					agg->groupBy = AGG_GROUP_AGE;
+				}else if(valLen == 6 && strncmp(eq,"domain",6) == 0){
+					agg->groupBy = AGG_GROUP_DOMAIN;
+				}else{
+					retFlag = false;
+				}
+
+			}else if(keyLen == 4 && strncmp(p,"band",4) == 0){
+
+				agg->bandWidth = atoi(eq);
+				if(agg->bandWidth <= 0){
+					retFlag = false;
+				}
+
+			}else if(keyLen == 5 && strncmp(p,"field",5) == 0){
+
+				agg->field = personField(eq,valLen);
+				if(agg->field < 0 || !personFieldIsNum[agg->field]){ // any numeric field of the schema
+					retFlag = false;
+				}
+
+			}else{
+
+				retFlag = false;
+			}
+		}
+
+		p = (*end == '&') ? end+1 : end;
+	}
+
+	return retFlag;
+}
+
+
+// Maps the domain of an e-mail address to a group number through a small open addressing table.
+static int aggDomainGroup(aggStruct * agg, short * table, int tableSize, const struct Person * rec){
+
+	const char * at = memchr(rec->emailAddress,'@',sizeof(rec->emailAddress));
+	const char * dom = (at != NULL) ? at+1 : "(none)";
+	int len = (at != NULL) ? (int)strnlen(dom,sizeof(rec->emailAddress) - (dom - rec->emailAddress)) : 6;
+	unsigned int h = 2166136261u;
+	int i,g;
+
+	for(i=0;i<len;i++){
+		h = (h ^ (unsigned char)dom[i]) * 16777619u;
+	}
+
+	for(i=h & (tableSize-1);table[i] >= 0;i=(i+1) & (tableSize-1)){
+
+		g = table[i];
+		if(strncmp(agg->keys[g],dom,len) == 0 && agg->keys[g][len] == '\0'){
+			return g;
+		}
+	}
+
+	if(agg->groupCount == AGG_MAX_GROUPS-1){ // Out of groups, everything else lands in one bucket
+
+		strcpy(agg->keys[AGG_MAX_GROUPS-1],"(other)");
+		agg->groupCount = AGG_MAX_GROUPS;
+	}
+	if(agg->groupCount == AGG_MAX_GROUPS){
+		return AGG_MAX_GROUPS-1;
+	}
+
+	g = agg->groupCount++;
+	if(len > 49){
+		len = 49;
+	}
+	memcpy(agg->keys[g],dom,len);
+	agg->keys[g][len] = '\0';
+	table[i] = g;
+
+	return g;
+}
+
+
+int aggregateList(struct Person * headNode, aggStruct * agg){
+
+	struct Person * walker;
+	unsigned short * grp = NULL;
+	long long * val;
+	aggTask * tasks;
+	scanStruct scan;
+	short domTable[AGG_MAX_GROUPS*2];
+	long rows = 0,i;
+	int g,t,threads = 1;
+
+	if(!scanOpen(&scan,headNode)){
+		return -1;
+	}
+	rows = scan.count;
+
+	val = (long long *)malloc((rows > 0 ? rows : 1)*sizeof(long long));
+	if(agg->groupBy != AGG_GROUP_NONE){
+		grp = (unsigned short *)malloc((rows > 0 ? rows : 1)*sizeof(unsigned short));
+	}
+	if(val == NULL || (agg->groupBy != AGG_GROUP_NONE && grp == NULL)){
+
+		throwError(3,__LINE__);
+		free(val);
+		free(grp);
+		scanClose(&scan);
+		return -1;
+	}
+
+	agg->groupCount = (agg->groupBy == AGG_GROUP_NONE) ? 1 : 0;
+	strcpy(agg->keys[0],"(all)");
+	memset(domTable,-1,sizeof(domTable));
+
+	for(walker=scanNext(&scan),i=0;walker != NULL && i < rows;walker=scanNext(&scan),i++){ // Gather pass, the only pointer chase
+
+		switch(agg->field){
+#define PERSON_AGG_NUM(name,type,label) case(PF_##name): val[i] = (long long)walker->name; break;
+#define PERSON_AGG_TEXT(name,size,label)
+			PERSON_FIELDS(PERSON_AGG_NUM,PERSON_AGG_TEXT)
+#undef PERSON_AGG_NUM
+#undef PERSON_AGG_TEXT
+			default: val[i] = 0; break;
+		}
+
+		if(agg->groupBy == AGG_GROUP_AGE){
+
+			g = (walker->age < 0 ? 0 : walker->age) / agg->bandWidth;
+			grp[i] = (unsigned short)(g < AGG_MAX_GROUPS ? g : AGG_MAX_GROUPS-1);
+
+		}else if(agg->groupBy == AGG_GROUP_DOMAIN){
+
+			grp[i] = (unsigned short)aggDomainGroup(agg,domTable,AGG_MAX_GROUPS*2,walker);
+		}
+	}
+
+	scanClose(&scan);
+	rows = i;
+
+	#if !defined(_WIN32)
+	if(rows >= AGG_PARALLEL_MIN){
+
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		threads = threads < 1 ? 1 : (threads > AGG_MAX_THREADS ? AGG_MAX_THREADS : threads);
+	}
+	#endif
+
+	tasks = (aggTask *)malloc(threads*sizeof(aggTask));
+	if(tasks == NULL){
+
+		throwError(3,__LINE__);
+		free(val);
+		free(grp);
+		return -1;
+	}
+
+	for(t=0;t<threads;t++){
+
+		tasks[t].grp = grp;
+		tasks[t].val = val;
+		tasks[t].lo = rows*t/threads;
+		tasks[t].hi = rows*(t+1)/threads;
+	}
+
+	#if !defined(_WIN32)
+	{
+		pthread_t tid[AGG_MAX_THREADS];
+		bool started[AGG_MAX_THREADS];
+
+		for(t=1;t<threads;t++){
+			started[t] = (pthread_create(&tid[t],NULL,aggReduce,&tasks[t]) == 0);
+		}
+		aggReduce(&tasks[0]);
+		for(t=1;t<threads;t++){
+			if(started[t]){
+				pthread_join(tid[t],NULL);
+			}else{
+				aggReduce(&tasks[t]); // couldn't get a thread, do the slice here
+			}
+		}
+	}
+	#else
+	aggReduce(&tasks[0]);
+	#endif
+
+	for(g=0;g<AGG_MAX_GROUPS;g++){ // Merge the per-thread totals
+
+		agg->count[g] = 0;
+		agg->sum[g] = 0;
+		agg->min[g] = LLONG_MAX;
+		agg->max[g] = LLONG_MIN;
+
+		for(t=0;t<threads;t++){
+			agg->count[g] += tasks[t].count[g];
+			agg->sum[g] += tasks[t].sum[g];
+			agg->min[g] = tasks[t].min[g] < agg->min[g] ? tasks[t].min[g] : agg->min[g];
+			agg->max[g] = tasks[t].max[g] > agg->max[g] ? tasks[t].max[g] : agg->max[g];
+		}
+	}
+
+	if(agg->groupBy == AGG_GROUP_AGE){ // Bands are named after the fact, only the non-empty ones are shown
+
+		agg->groupCount = AGG_MAX_GROUPS;
+		for(g=0;g<AGG_MAX_GROUPS;g++){
+			snprintf(agg->keys[g],sizeof(agg->keys[g]),"%d-%d",g*agg->bandWidth,(g+1)*agg->bandWidth-1);
+		}
+		snprintf(agg->keys[AGG_MAX_GROUPS-1],sizeof(agg->keys[0]),"%d+",(AGG_MAX_GROUPS-1)*agg->bandWidth);
+	}
+
+	free(tasks);
+	free(val);
+	free(grp);
+
+	return agg->groupCount;
+}
+
+
+static int aggFormat(aggStruct * agg, char * buf, int bufLen){
+
+	int len,g;
+
+	len = snprintf(buf,bufLen,"%-30s %10s %16s %14s %14s %14s\r\n","GROUP","COUNT","SUM","MIN","MAX","AVG");
+
+	for(g=0;g<agg->groupCount && len < bufLen;g++){
+
+		if(agg->count[g] == 0){
+			continue;
+		}
+		len += snprintf(buf+len,bufLen-len,"%-30s %10ld %16lld %14lld %14lld %14.2f\r\n",agg->keys[g],agg->count[g],agg->sum[g],
+			agg->min[g],agg->max[g],(double)agg->sum[g]/agg->count[g]);
+	}
+
+	if(len < bufLen){
+		len += snprintf(buf+len,bufLen-len,"(field : %s)\r\n",personFieldNames[agg->field]);
+	}
+
+	return len < bufLen ? len : bufLen-1;
+}
+
+
+// Streaming import / export
+// Lines are parsed in place inside the read buffer; fields are copied straight into a
+// stack struct Person, so there's no allocation per row or per field. A line cut by the
+// end of the buffer is moved to the front and the buffer is topped up behind it.
+// CSV columns : id,fName,lName,age,emailAddress,phone (an optional header line is skipped,
+// fields may be "quoted" with "" for a quote). JSON-lines : one flat object per line with
+// the same key names. Records can't span lines in either format.
+//***************************************************************************************
+static int fileFormat(const char * path){
+
+	const char * dot = strrchr(path,'.');
+	int retFlag = FMT_CSV;
+
+	if(dot != NULL && (strcmp(dot,".json") == 0 || strcmp(dot,".jsonl") == 0 || strcmp(dot,".ndjson") == 0)){
+		retFlag = FMT_JSONL;
+	}
+
+	return retFlag;
+}
+
+
+// Parses an optionally signed decimal, surrounding blanks allowed. False on anything else,
+// including values past what a long long holds (the field's own range is checked by the caller).
+static bool parseNumber(const char * p, const char * end, long long * val){
+
+	long long v = 0;
+	bool neg = false,digits = false,fits = true;
+
+	while(p < end && (*p == ' ' || *p == '\t')){
+		p++;
+	}
+	if(p < end && (*p == '-' || *p == '+')){
+		neg = (*p == '-');
+		p++;
+	}
+	while(p < end && *p >= '0' && *p <= '9'){
+		if(v > (LLONG_MAX - (*p - '0')) / 10){
+			fits = false; // keep going to the end, the line is bad either way
+		}else{
+			v = v*10 + (*p - '0');
+		}
+		digits = true;
+		p++;
+	}
+	while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')){
+		p++;
+	}
+
+	*val = neg ? -v : v;
+	return digits && fits && p == end;
+}
+
+
+// Copies one CSV field into dst, a fixed-width field of dstSize chars (terminated only if shorter, like the
+// record's text fields), and returns where the next field starts. *fits goes false if the value was cut.
+static const char * csvField(const char * p, const char * end, char * dst, int dstSize, bool * fits){
+
+	int n = 0;
+	bool cut = false;
+
+	if(p < end && *p == '"'){
+
+		p++;
+		while(p < end){
+
+			if(*p == '"'){
+				if(p+1 < end && p[1] == '"'){
+					p++;
+				}else{
+					p++;
+					break;
+				}
+			}
+			if(n < dstSize){
+				dst[n++] = *p;
+			}else{
+				cut = true;
+			}
+			p++;
+		}
+		while(p < end && *p != ','){
+			p++;
+		}
+
+	}else{
+
+		while(p < end && *p != ','){
+			if(n < dstSize){
+				dst[n++] = *p;
+			}else{
+				cut = true;
+			}
+			p++;
+		}
+	}
+
+	if(n < dstSize){
+		dst[n] = '\0';
+	}
+	if(cut){
+		*fits = false;
+	}
+	return (p < end) ? p+1 : p;
+}
+
+
+static bool parseCsvLine(const char * p, const char * end, struct Person * rec){
+
+	char num[24];
+	long long v = 0;
+	bool retFlag = true;
+
+	memset(rec,0,sizeof(struct Person));
+
+#define PERSON_CSV_NUM(name,type,label) \
+	p = csvField(p,end,num,sizeof(num)-1,&retFlag); \
+	num[sizeof(num)-1] = '\0'; \
+	retFlag = retFlag && parseNumber(num,num+strlen(num),&v) && PERSON_FITS(type,v); \
+	rec->name = (type)v;
+#define PERSON_CSV_TEXT(name,size,label) \
+	p = csvField(p,end,rec->name,size,&retFlag); // a longer value would come back cut, the line is bad instead
+	PERSON_FIELDS(PERSON_CSV_NUM,PERSON_CSV_TEXT)
+#undef PERSON_CSV_NUM
+#undef PERSON_CSV_TEXT
+
+	return retFlag;
+}
+
+
+// Decodes a JSON string starting at the opening quote into dst (NULL to skip it), a fixed-width field of dstSize chars
+// as csvField fills them. Returns the position after the closing quote, NULL if unterminated or too long for dst.
+static const char * jsonString(const char * p, const char * end, char * dst, int dstSize){
+
+	int n = 0;
+	bool cut = false;
+	char c;
+
+	for(p++;p < end && *p != '"';p++){
+
+		c = *p;
+		if(c == '\\' && p+1 < end){
+
+			p++;
+			switch(*p){
+				case('n'): c = '\n'; break;
+				case('t'): c = '\t'; break;
+				case('r'): c = '\r'; break;
+				case('b'): c = '\b'; break;
+				case('f'): c = '\f'; break;
+				case('u'): c = '?'; p = (p+4 < end) ? p+4 : end-1; break; // the fields are plain char, no room for code points
+				default: c = *p; break; // \" \\ \/
+			}
+		}
+		if(dst != NULL && n < dstSize){
+			dst[n++] = c;
+		}else if(dst != NULL){
+			cut = true;
+		}
+	}
+
+	if(dst != NULL && n < dstSize){
+		dst[n] = '\0';
+	}
+	return (p < end && !cut) ? p+1 : NULL;
+}
+
+
+static bool parseJsonLine(const char * p, const char * end, struct Person * rec){
+
+	const char * key;
+	const char * numEnd;
+	int keyLen;
+	long long v;
+	unsigned int seen = 0; // bit PF_x for every number field read
+	char * dst;
+	int dstSize;
+
+	memset(rec,0,sizeof(struct Person));
+
+	while(p < end && *p != '{'){
+		p++;
+	}
+	if(p == end){
+		return false;
+	}
+	p++;
+
+	while(p != NULL && p < end){
+
+		while(p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')){
+			p++;
+		}
+		if(p == end || *p == '}'){
+			break;
+		}
+		if(*p != '"'){
+			return false;
+		}
+
+		key = p+1;
+		p = jsonString(p,end,NULL,0);
+		if(p == NULL){
+			return false;
+		}
+		keyLen = (int)(p - 1 - key);
+
+		while(p < end && (*p == ' ' || *p == ':')){
+			p++;
+		}
+		if(p == end){
+			return false;
+		}
+
+		if(*p == '"'){ // string value
+
+			dst = NULL;
+			dstSize = 0;
+#define PERSON_JSON_NUM(name,type,label)
+#define PERSON_JSON_TEXT(name,size,label) \
+			if(keyLen == (int)sizeof(#name)-1 && memcmp(key,#name,keyLen) == 0){ \
+				dst = rec->name; dstSize = size; \
+			}
+			PERSON_FIELDS(PERSON_JSON_NUM,PERSON_JSON_TEXT)
+#undef PERSON_JSON_NUM
+#undef PERSON_JSON_TEXT
+			p = jsonString(p,end,dst,dstSize);
+			if(p == NULL){
+				return false; // unterminated, or longer than its field
+			}
+
+		}else{ // number (anything else unquoted is taken as one and rejected if it isn't)
+
+			numEnd = p;
+			while(numEnd < end && *numEnd != ',' && *numEnd != '}'){
+				numEnd++;
+			}
+			if(!parseNumber(p,numEnd,&v)){
+				return false;
+			}
+#define PERSON_JSON_NUM(name,type,label) \
+			if(keyLen == (int)sizeof(#name)-1 && memcmp(key,#name,keyLen) == 0){ \
+				if(!PERSON_FITS(type,v)){ \
+					return false; \
+				} \
+				rec->name = (type)v; seen |= 1u << PF_##name; \
+			}
+#define PERSON_JSON_TEXT(name,size,label)
+			PERSON_FIELDS(PERSON_JSON_NUM,PERSON_JSON_TEXT)
+#undef PERSON_JSON_NUM
+#undef PERSON_JSON_TEXT
+			p = numEnd;
+		}
+	}
+
+	return (seen >> PF_id) & 1; // the id is the one field a record can't do without
+}
+
+
+int importFile(struct Person ** headNode, char * path){
+
+	FILE * in = fopen(path,"rb");
+	char * buf;
+	char * line;
+	char * nl;
+	size_t have = 0,got;
+	long lineNo = 0,inserted = 0,dupes = 0,bad = 0,conflicts = 0;
+	int format = fileFormat(path);
+	bool eof = false,ok,skipping = false;
+	struct Person rec;
+	struct Person * stored;
+	struct idxNode * entry;
+	idxStruct * idx;
+	unsigned int diff;
+	int field;
+
+	if(in == NULL){
+
+		throwError(7,__LINE__);
+		return -1;
+	}
+
+	buf = (char *)malloc(IO_BUF_SIZE+1);
+	if(buf == NULL){
+
+		throwError(3,__LINE__);
+		fclose(in);
+		return -1;
+	}
+
+	while(!eof || have > 0){
+
+		if(!eof){
+
+			got = fread(buf+have,1,IO_BUF_SIZE-have,in);
+			have += got;
+			eof = (got == 0);
+		}
+
+		if(skipping){ // rest of a line longer than the buffer, dropped up to its newline
+
+			nl = memchr(buf,'\n',have);
+			if(nl == NULL){
+				have = 0;
+				continue;
+			}
+			have = buf+have-(nl+1);
+			memmove(buf,nl+1,have);
+			skipping = false;
+		}
+
+		line = buf;
+		while(line < buf+have){
+
+			nl = memchr(line,'\n',buf+have-line);
+			if(nl == NULL){
+
+				if(eof){
+
+					nl = buf+have; // last line without a newline
+
+				}else if(line != buf || have < IO_BUF_SIZE){
+
+					break; // cut line, refill behind it (or find out it's the last one)
+
+				}else{ // a single line longer than the buffer, not a record we can hold
+
+					VPRINTF(VERB_VERBOSE,"\nLine %ld is longer than the buffer, skipped",++lineNo);
+					bad++;
+					skipping = true;
+					line = buf+have;
+					break;
+				}
+			}
+
+			lineNo++;
+			if(nl > line && !(nl-line == 1 && *line == '\r')){
+
+				if(format == FMT_JSONL){
+					ok = parseJsonLine(line,nl,&rec);
+				}else{
+					ok = parseCsvLine(line,nl,&rec);
+					if(!ok && lineNo == 1){ // header
+						line = nl+1;
+						continue;
+					}
+				}
+
+				if(!ok){
+
+					VPRINTF(VERB_VERBOSE,"\nLine %ld could not be parsed",lineNo);
+					bad++;
+
+				}else if(insertNode(headNode,rec) > 0){
+
+					inserted++;
+
+				}else{
+
+					dupes++;
 
-	fwrite(&tempLog,sizeof(tempLog),1,logFile);
+					idx = storeIndex(rec.id); // same id, but is it the same employee?
+					entry = (idx != NULL) ? idxFind(idx,rec.id) : NULL;
+					stored = (entry != NULL) ? entryRecord(idx,entry) : NULL;
+					diff = (stored != NULL) ? personDiff(stored,&rec) : 0;
+					if(diff != 0){
 
+						for(field=0;!((diff >> field) & 1);field++){ // first one that differs, for the message
+							;
+						}
+						conflicts++;
+						VPRINTF(VERB_VERBOSE,"\nLine %ld : id %d is already stored with a different %s, kept the stored one",lineNo,rec.id,personFieldNames[field]);
+					}
+				}
+			}
+			line = nl+1;
+		}
 
-}
+		if(line >= buf+have){
 
+			have = 0;
 
-int deleteNode(struct Person ** firstNode, int delVal){
+		}else{
 
+			have = buf+have-line;
+			memmove(buf,line,have);
+		}
+	}
 
-	int retFlag = -1,exist,i=0;
+	VPRINTF(VERB_NORMAL,"\nImported %ld records from %s (%ld duplicates, %ld of them differing from the stored record, %ld bad lines)\n",inserted,path,dupes,conflicts,bad);
 
-	if(*firstNode == NULL){ // If head is NULL (Lists Empty), throw an error and return;
+	free(buf);
+	fclose(in);
+	return (int)inserted;
+}
 
-		throwError(-1,__LINE__); 
 
-	}else{
+// Appenders for exportFile. Each one assumes the caller left room for a full record.
+static char * appendNumber(char * out, long long v){
 
-		printf("\nNode %d about to be deleted..\n");
+	char tmp[24];
+	int n = 0;
+	unsigned long long u = (v < 0) ? (unsigned long long)(-v) : (unsigned long long)v;
 
-		struct Person *walker = *firstNode;
+	if(v < 0){
+		*out++ = '-';
+	}
+	do{
+		tmp[n++] = (char)('0' + u % 10);
+		u /= 10;
+	}while(u != 0);
+	while(n > 0){
+		*out++ = tmp[--n];
+	}
 
-		exist = searchList(*firstNode,delVal,1); //Get the poaition of the value to be deleted. returns -1 if not found..
-		if(exist >= 0){
-			changesMade = 1;
-			struct Person * temp = (struct Person*)malloc(sizeof(struct Person));
-			retFlag = 1;
-			if(exist == 0){ //If the item is at position 1, i.e the head, we need to change head to the current head's next
+	return out;
+}
 
-				temp = *firstNode;
-				*firstNode = (*firstNode)->next;
-				free(temp);
-			
-			
-			}else{
-			
-				//Loop to go through the list until reached the desired location i.e 1 step before the index of value to be deleted.
 
-				for(i=0;i<exist-1;i++){ 
+static char * appendCsvText(char * out, const char * field, int fieldSize){
 
-					walker=walker->next;
-				}
+	int len = (int)strnlen(field,fieldSize),i;
 
-				
-				
-				temp = walker->next; // set temp = node to be deleted.
-				walker->next = walker->next->next; // current node's next now points to it's next->next , i.e temp->next
-				free(temp); //free temp 
-			}
+	if(memchr(field,',',len) == NULL && memchr(field,'"',len) == NULL && memchr(field,'\n',len) == NULL){
 
-			displayMessage(1,delVal);
-			changesMade = 1;
-			
-			//printf("\n\nValue %d Deleted Successfully..\n\n",delVal);
-		}else{
+		memcpy(out,field,len);
+		return out+len;
+	}
 
-			displayMessage(3,delVal);
+	*out++ = '"';
+	for(i=0;i<len;i++){
+		if(field[i] == '"'){
+			*out++ = '"';
 		}
-
+		*out++ = field[i];
 	}
-	return retFlag;
+	*out++ = '"';
 
+	return out;
 }
 
 
+static char * appendJsonText(char * out, const char * key, const char * field, int fieldSize){
 
-int searchList(struct Person * headN,int searchVal, int searchFlag){
-
-	int counter=0,foundFlag=-1;
-	if(headN == NULL){
+	int len = (int)strnlen(field,fieldSize),i;
+	unsigned char c;
 
-		if(searchFlag == 1){
-			throwError(-1,__LINE__);
+	*out++ = '"';
+	while(*key != '\0'){
+		*out++ = *key++;
+	}
+	*out++ = '"';
+	*out++ = ':';
+	*out++ = '"';
+	for(i=0;i<len;i++){
+
+		c = (unsigned char)field[i];
+		if(c == '"' || c == '\\'){
+			*out++ = '\\';
+			*out++ = (char)c;
+		}else if(c < 0x20){
+			out += sprintf(out,"\\u%04x",c);
 		}else{
-			foundFlag = -2;
+			*out++ = (char)c;
 		}
-	
-	}else{
+	}
+	*out++ = '"';
 
-		struct Person *walker = headN;
-		struct Person per;
+	return out;
+}
 
 
-			
-			
+// One record as a CSV line, without the newline.
+static char * appendCsvRecord(char * out, const struct Person * rec){
 
-			while(walker != NULL){
-				
-				if(walker->id == searchVal){
+#define PERSON_OUT_NUM(name,type,label) \
+	out = appendNumber(out,(long long)rec->name); \
+	*out++ = ',';
+#define PERSON_OUT_TEXT(name,size,label) \
+	out = appendCsvText(out,rec->name,size); \
+	*out++ = ',';
+	PERSON_FIELDS(PERSON_OUT_NUM,PERSON_OUT_TEXT)
+#undef PERSON_OUT_NUM
+#undef PERSON_OUT_TEXT
 
-					if(searchFlag == 1){
-						foundFlag=counter;
-						per.id = walker->id;
-						strncpy(per.fName,walker->fName,sizeof(walker->fName));
-						strncpy(per.lName,walker->lName,sizeof(walker->lName));
-						per.age = walker->age;
-						strncpy(per.emailAddress,walker->emailAddress,sizeof(walker->emailAddress));
-						per.phone = walker->phone;
+	return out-1; // no comma after the last field
+}
 
-					
-						printf("\nFound at Position %d...\n",counter);
-					
-						printInfo(per);
 
-					}else{
+// One record as a JSON object, without the newline.
+static char * appendJsonRecord(char * out, const struct Person * rec){
 
-						foundFlag = 1;
-					}
-	
-					
-					
-					break;
-				}
-			
-				walker = walker->next;
+	*out++ = '{';
+#define PERSON_OUT_NUM(name,type,label) \
+	memcpy(out,"\"" #name "\":",sizeof(#name)+2); out += sizeof(#name)+2; \
+	out = appendNumber(out,(long long)rec->name); \
+	*out++ = ',';
+#define PERSON_OUT_TEXT(name,size,label) \
+	out = appendJsonText(out,#name,rec->name,size); \
+	*out++ = ',';
+	PERSON_FIELDS(PERSON_OUT_NUM,PERSON_OUT_TEXT)
+#undef PERSON_OUT_NUM
+#undef PERSON_OUT_TEXT
+	out[-1] = '}'; // over the last comma
 
-				counter++;
+	return out;
+}
 
 
-			}
-			if(foundFlag == -1 && searchFlag == 1){
+int exportFile(struct Person * headNode, char * path){
 
-				displayMessage(3,searchVal);
-				
-			}
+	FILE * out = fopen(path,"wb");
+	char * buf;
+	char * p;
+	struct Person * walker;
+	scanStruct scan;
+	long written = 0;
+	int format = fileFormat(path);
+	bool ok = true;
+	int worstRecord = 6*(int)sizeof(struct Person) + 256; // every byte escaped to \uXXXX, plus keys
 
-		}
+	if(out == NULL){
 
+		throwError(7,__LINE__);
+		return -1;
+	}
 
+	buf = (char *)malloc(IO_BUF_SIZE);
+	if(buf == NULL || !scanOpen(&scan,headNode)){
 
-	return foundFlag;
-}
+		throwError(3,__LINE__);
+		free(buf);
+		fclose(out);
+		return -1;
+	}
 
-int printList(struct Person * headNode,int printFlag){
+	p = buf;
+	if(format == FMT_CSV){
 
+#define PERSON_HEAD(name,...) #name ","
+		static const char header[] = PERSON_FIELDS(PERSON_HEAD,PERSON_HEAD);
+#undef PERSON_HEAD
+		memcpy(p,header,sizeof(header)-2); // without the last comma
+		p += sizeof(header)-2;
+		*p++ = '\n';
+	}
 
-	int itemCounter=0;
+	for(walker=scanNext(&scan);walker != NULL;walker=scanNext(&scan)){
 
-	printf("\n\n***********************************************************************\n\n");
+		p = (format == FMT_JSONL) ? appendJsonRecord(p,walker) : appendCsvRecord(p,walker);
+		*p++ = '\n';
+		written++;
 
-	if(headNode == NULL){
+		if(p - buf > IO_BUF_SIZE - worstRecord){
 
-		displayMessage(4,0);
+			if(fwrite(buf,1,p-buf,out) != (size_t)(p-buf)){
+				ok = false;
+				break;
+			}
+			p = buf;
+		}
+	}
 
-	}else{
+	if(ok && fwrite(buf,1,p-buf,out) != (size_t)(p-buf)){
+		ok = false;
+	}
+	scanClose(&scan);
+	free(buf);
 
-		struct Person *walker = (struct Person *)malloc(sizeof(struct Person));
-		walker = headNode;
-	
-		while(walker != NULL){
+	if(fclose(out) != 0){ // a full disk may only show up here
+		ok = false;
+	}
 
-			if(printFlag == 1){
+	if(!ok){
 
-				printf("| %d - %s - %s - %d - %s - %lu \n\n",walker->id, walker->fName,walker->lName,walker->age,walker->emailAddress,walker->phone);
-			}
-			
-			walker = walker->next;
-			itemCounter++;
-		}
+		throwError(7,__LINE__);
+		return -1;
 	}
 
-	if(printFlag == 1){
-		printf("\n\nTOTAL ITEMS : %d\n\n",itemCounter);
-		printf("\n\nTOTAL SIZE (BYTES) : %lu (%lu KB)\n\n",itemCounter*sizeof(struct Person),(itemCounter*sizeof(struct Person))/1024);
-	}
-	return itemCounter;
+	VPRINTF(VERB_NORMAL,"\nExported %ld records to %s\n",written,path);
+	return (int)written;
 }
 
-int insertNode(struct Person ** headNode, struct Person newNode){
 
-	int i=1;
-	int itemCounter=0;
-	
-	if(*headNode == NULL){ //If head is null, that means the list doesn't exist.. Add the first node (head);
+// Person schema : the per-field code expanded from PERSON_FIELDS
+// Each field gets its own straight line code (fixed sizes, no lookups by name at run time).
+//***************************************************************************************
+static void personCopy(struct Person * dst, const struct Person * src){
 
-		*headNode = (struct Person *)malloc(sizeof(struct Person));
+#define PERSON_COPY_NUM(name,type,label) dst->name = src->name;
+#define PERSON_COPY_TEXT(name,size,label) memcpy(dst->name,src->name,size); // whole field, a full-length value has no terminator to keep
+	PERSON_FIELDS(PERSON_COPY_NUM,PERSON_COPY_TEXT)
+#undef PERSON_COPY_NUM
+#undef PERSON_COPY_TEXT
+}
 
-		if(*headNode == NULL){
-			throwError(3,__LINE__);		
-		}else{
-		
 
-			(*headNode)->id=newNode.id;
-			strncpy((*headNode)->fName,newNode.fName,sizeof(newNode.fName)/sizeof(char));
-			strncpy((*headNode)->lName,newNode.fName,sizeof(newNode.lName)/sizeof(char));
-			(*headNode)->age=newNode.age;
-			strncpy((*headNode)->emailAddress,newNode.fName,sizeof(newNode.emailAddress)/sizeof(char));
-			//strncpy((temp->fName),newNode.fName,sizeof(newNode.phone)/sizeof(char));
-			(*headNode)->phone = newNode.phone;
-			(*headNode)->next = NULL;
-			//*headNode = temp;
-			itemCounter++;
-			changesMade=1;
-			printf("\nNew Node Id : %d",(*headNode)->id);
-		}
-	
-	}else{
+static unsigned int personDiff(const struct Person * a, const struct Person * b){
 
+	unsigned int diff = 0;
 
-		struct Person *walker = (struct Person*)malloc(sizeof(struct Person));
-		walker= *headNode ;
-		//*headNode;
-		while(walker->next != NULL){
-			walker=walker->next;
-			itemCounter++;
+#define PERSON_DIFF_NUM(name,type,label) diff |= (unsigned int)(a->name != b->name) << PF_##name;
+#define PERSON_DIFF_TEXT(name,size,label) diff |= (unsigned int)(strncmp(a->name,b->name,size) != 0) << PF_##name;
+	PERSON_FIELDS(PERSON_DIFF_NUM,PERSON_DIFF_TEXT)
+#undef PERSON_DIFF_NUM
+#undef PERSON_DIFF_TEXT
 
-		}
+	return diff;
+}
 
-		walker->next = (struct Person *)malloc(sizeof(struct Person));
 
-		walker->next->id=newNode.id;
-		strncpy(walker->next->fName,newNode.fName,sizeof(newNode.fName)/sizeof(char));
-		strncpy(walker->next->lName,newNode.lName,sizeof(newNode.lName)/sizeof(char));
-		walker->next->age=newNode.age;
-		strncpy(walker->next->emailAddress,newNode.emailAddress,sizeof(newNode.emailAddress)/sizeof(char));
-		walker->next->phone = newNode.phone;
-	
-		printf("\nNew Node Id : %d",walker->next->id);
-		walker->next->next = NULL;
-		itemCounter++;
-		changesMade=1; // changes were made to our data..
-		
+static int personField(const char * name, int len){
 
+	int retFlag = -1;
+
+#define PERSON_MATCH(field,...) \
+	if(len == (int)sizeof(#field)-1 && memcmp(name,#field,len) == 0){ \
+		retFlag = PF_##field; \
 	}
+	PERSON_FIELDS(PERSON_MATCH,PERSON_MATCH)
+#undef PERSON_MATCH
 
-	return itemCounter;
+	return retFlag;
+}
+
+
+static void printLine(const struct Person * rec){
+
+	char line[8*sizeof(struct Person) + 16];
+	char * out = line;
+	int len;
+
+	*out++ = '|';
+#define PERSON_LINE_NUM(name,type,label) \
+	*out++ = ' '; \
+	out = appendNumber(out,(long long)rec->name); \
+	memcpy(out," -",2); out += 2;
+#define PERSON_LINE_TEXT(name,size,label) \
+	*out++ = ' '; \
+	len = (int)strnlen(rec->name,size); \
+	memcpy(out,rec->name,len); out += len; \
+	memcpy(out," -",2); out += 2;
+	PERSON_FIELDS(PERSON_LINE_NUM,PERSON_LINE_TEXT)
+#undef PERSON_LINE_NUM
+#undef PERSON_LINE_TEXT
+	memcpy(out-1,"\n\n",2); // over the last dash, leaving "| 1 - ... - 5 \n\n"
+	out++;
+
+	fwrite(line,1,out-line,stdout);
 }
 
 
@@ -858,6 +5124,13 @@ void throwError(int errorCode, int lineNo){
 			break;
 		case(5):
 			printf("\n\n[READIN ERROR] DATA in unstructured.\n");
+			break;
+		case(7):
+			printf("\n\n[IMPORT/EXPORT ERROR] File could not be opened or written.\n");
+			break;
+		case(6):
+			printf("\n\n[QUERY ERROR] Bad aggregation query. Expected group=none|age|domain&band=N&field=age|id|phone\n");
+			break;
 
 	}
 	
@@ -866,30 +5139,192 @@ void throwError(int errorCode, int lineNo){
 	
 
 
+// Reads a whole decimal int argument, false if it isn't one.
+static bool argToInt(const char * arg, int * val){
+
+	char * end;
+	long l;
+
+	errno = 0;
+	l = strtol(arg,&end,10);
+
+	if(errno != 0 || end == arg || *end != '\0' || l < INT_MIN || l > INT_MAX){
+		return false;
+	}
+
+	*val = (int)l;
+	return true;
+}
+
+
+
+// Picks the data file (first non-option argument) and applies option flags.
+// -q : errors and prompts only, -v : per-record output
+// -range lo hi : print employees with lo <= id <= hi in id order, -limit n : at most n of them
+// -agg query : print an aggregation, e.g. -agg "group=age&band=10&field=age" (same query as GET /agg?...)
+// -import file / -export file : CSV or JSON-lines (picked by extension), import runs before export
+// -lazy n : index the ids only and read records in on demand, keeping at most n of them cached
+// -compact : the save rewrites the whole file (drops tombstones) instead of writing only the changes
+//*********************************************************************************
+static bool parseArgs(int argc, char *argv[], char ** dataFile){
+
+	int i;
+	bool retFlag = true;
+
+	*dataFile = NULL;
+
+	for(i=1;i<argc;i++){
+
+		if(strcmp(argv[i],"-q") == 0){
+
+			verbosity = VERB_QUIET;
+
+		}else if(strcmp(argv[i],"-v") == 0){
+
+			verbosity = VERB_VERBOSE;
+
+		}else if(strcmp(argv[i],"-range") == 0 && i+2 < argc){
+
+			options.rangeFlag = true;
+			if(!argToInt(argv[i+1],&options.rangeLo) || !argToInt(argv[i+2],&options.rangeHi)){
+				retFlag = false;
+			}
+			i += 2;
+
+		}else if(strcmp(argv[i],"-agg") == 0 && i+1 < argc){
+
+			options.aggQuery = argv[i+1];
+			i++;
+
+		}else if(strcmp(argv[i],"-import") == 0 && i+1 < argc){
+
+			options.importFile = argv[i+1];
+			i++;
+
+		}else if(strcmp(argv[i],"-export") == 0 && i+1 < argc){
+
+			options.exportFile = argv[i+1];
+			i++;
+
+		}else if(strcmp(argv[i],"-lazy") == 0 && i+1 < argc){
+
+			if(!argToInt(argv[i+1],&options.lazyCache) || options.lazyCache <= 0){
+				retFlag = false;
+			}
+			i++;
+
+		}else if(strcmp(argv[i],"-compact") == 0){
+
+			options.compact = true;
+
+		}else if(strcmp(argv[i],"-aio") == 0 && i+1 < argc){
+
+			if(strcmp(argv[i+1],"uring") == 0){
+				aioMode = AIO_URING;
+			}else if(strcmp(argv[i+1],"threads") == 0){
+				aioMode = AIO_THREADS;
+			}else if(strcmp(argv[i+1],"sync") == 0){
+				aioMode = AIO_SYNC;
+			}else{
+				retFlag = false;
+			}
+			i++;
+
+		}else if(strcmp(argv[i],"-shards") == 0 && i+1 < argc){
+
+			if(!argToInt(argv[i+1],&options.shards) || options.shards <= 0 || options.shards > SHARD_MAX){
+				retFlag = false;
+			}
+			i++;
+
+		}else if(strcmp(argv[i],"-serve") == 0 && i+1 < argc){
+
+			if(!argToInt(argv[i+1],&options.serveSecs) || options.serveSecs <= 0){
+				retFlag = false;
+			}
+			i++;
+
+		}else if(strcmp(argv[i],"-backlog") == 0 && i+1 < argc){
+
+			if(!argToInt(argv[i+1],&options.backlog) || options.backlog <= 0){
+				retFlag = false;
+			}
+			i++;
+
+		}else if(strcmp(argv[i],"-maxconn") == 0 && i+1 < argc){
+
+			if(!argToInt(argv[i+1],&options.maxConn) || options.maxConn <= 0){
+				retFlag = false;
+			}
+			i++;
+
+		}else if(strcmp(argv[i],"-trace") == 0 && i+1 < argc){
+
+			options.traceFile = argv[i+1];
+			i++;
+
+		}else if(strcmp(argv[i],"-limit") == 0 && i+1 < argc){
+
+			if(!argToInt(argv[i+1],&options.rangeLimit) || options.rangeLimit < 0){
+				retFlag = false;
+			}
+			i++;
+
+		}else if(argv[i][0] != '-' && *dataFile == NULL){
+
+			*dataFile = argv[i];
+
+		}else{
+
+			retFlag = false;
+		}
+	}
+
+	if(*dataFile == NULL){
+
+		retFlag = false;
+	}
+
+	if(options.rangeLimit >= 0 && !options.rangeFlag){ // -limit pages a -range, alone it means nothing
+
+		retFlag = false;
+	}
+
+	return retFlag;
+}
+
+
+
 int main(int argc, char *argv[]){
 
 			unsigned long int a=0,counter=0;
+			long slotNo=0;
 			int i;
 			struct Person newPerson;
+			aioStream in;
+			char * chunk;
+			size_t got,k;
 
 
 			FILE* fp = NULL;
-			char fileName[20], userAns='n', userAns2='n',garbageChar,userAns3 = 'n';
+			char * dataFile = NULL;
+			char fileName[FILENAME_MAX], userAns='n', userAns2='n',garbageChar,userAns3 = 'n';
 			struct Person * head = NULL;
 
 			begin = clock();
-			if(argc != 2 || !self_init() ){
+			if(!parseArgs(argc,argv,&dataFile) || !self_init() ){
 
 				throwError(1,__LINE__);
 				return -1;
 
 			}else{
 
+				atexit(done); // from here on every way out flushes the log queue and stops its I/O
 
-				fp = fopen(argv[1],"rb");
+				fp = (options.shards > 0) ? NULL : fopen(dataFile,"rb"); // shards are opened when something routes to them
 
 
-				if(fp == NULL){
+				if(fp == NULL && options.importFile == NULL && options.shards == 0){ // With -import, a missing data file just means an empty roster
 
 					throwError(2,__LINE__);
 					
@@ -907,33 +5342,108 @@ int main(int argc, char *argv[]){
 						}
 					#endif
 
-						strncpy(fileName,argv[1],strlen(argv[1]));
-						printf("\nFileName : %s\n\n",fileName);
-						//rewind(fp);
-						fseek(fp,0,SEEK_SET);
+						if(snprintf(fileName,sizeof(fileName),"%s",dataFile) >= (int)sizeof(fileName)){ // the shard names and fileName.tmp are built from it
+
+							throwError(1,__LINE__);
+							return -1;
+						}
+						VPRINTF(VERB_NORMAL,"\nFileName : %s\n\n",fileName);
+					if(fp != NULL && options.lazyCache > 0){ // Only the ids are read now, records come in as they're used
+
+						fclose(fp);
+						fp = NULL;
+						if(!lazyOpen(&empIndex,dataFile,options.lazyCache)){
+							throwError(2,__LINE__);
+							return -1;
+						}
+						a = empIndex.count;
+
+					}
+
+					if(options.shards > 0 && !shardsInit(dataFile,options.shards,options.lazyCache > 0 ? options.lazyCache : SHARD_DEFAULT_CACHE)){
+
+						throwError(1,__LINE__);
+						return -1;
+					}
+
+					TRACE_BEGIN("load");
+					if(fp != NULL){
+
+					if(streamOpen(&in,fp,false)){ // chunks are read ahead while the ones already in get indexed
 
+					while((chunk = streamRead(&in,&got)) != NULL){
 
-					while(!feof(fp)){
+					for(k=0;k+PERSON_DISK_SIZE<=got;k+=PERSON_DISK_SIZE){
 
+						memcpy(&newPerson,chunk+k,PERSON_DISK_SIZE);
+						VPRINTF(VERB_VERBOSE,"\nNode %d\n",newPerson.id);
 
-						fread(&newPerson,sizeof(struct Person),1,fp);
-						printf("\nNode %d\n",newPerson.id);
+						if(newPerson.id == TOMBSTONE_ID){ // deleted slot, free for reuse
 
-						if(searchList(head,newPerson.id,0) ==  -2 || searchList(head,newPerson.id,0) != 1  ){
-							insertNode(&head,newPerson);
+							releaseSlot(&empIndex,slotNo,true);
+
+						}else if(insertNode(&head,newPerson) > 0){ // insertNode refuses ids already in the index
+							struct idxNode * entry = idxFind(&empIndex,newPerson.id);
+							entry->slot = slotNo;
+							entry->flags &= ~IDX_DIRTY; // it's already on disk
 							a++;
 
 						}else{
 
-							printf("\nValue %d already exists",newPerson.id);
+							releaseSlot(&empIndex,slotNo,false); // the first copy wins, this one gets punched on save
+							counter++;
 						}
+						slotNo++;
 						
 					}
+					}
+
+					if(!streamClose(&in)){ // a read failed part way, the records after it were never seen
+
+						throwError(5,__LINE__);
+						TRACE_END();
+						return -1;
+					}
+
+					}else{
+
+						throwError(5,__LINE__); // streamOpen has said why
+						TRACE_END();
+						return -1;
+					}
+
+					empIndex.slotCount = slotNo;
+					empIndex.dirtyCount = 0;
+					if(empIndex.bloomFailed){
+						bloomRebuild(&empIndex); // one more try now the load is done
+					}
+
+					fclose(fp); // Close the file immediately;
+					}
+					TRACE_END();
 
 					totalNodes = a;
+					if(shardCount > 0){
+						VPRINTF(VERB_NORMAL,"\nSharded store : %s.0 .. %s.%d\n",dataFile,dataFile,shardCount-1);
+					}else if(empIndex.lazy == NULL){
+						VPRINTF(VERB_NORMAL,"\nLoaded %lu records (%lu duplicates skipped)\n",a,counter);
+					}
 
 					changesMade=0;
-					fclose(fp); // Close the file immediately;
+
+					if(options.importFile != NULL){
+
+						TRACE_BEGIN("import");
+						importFile(&head,options.importFile);
+						TRACE_END();
+					}
+
+					if(options.exportFile != NULL){
+
+						TRACE_BEGIN("export");
+						exportFile(head,options.exportFile);
+						TRACE_END();
+					}
 
 
 
@@ -941,6 +5451,34 @@ int main(int argc, char *argv[]){
 					//readFile(&head,&fp);
 			
 					
+					if(options.aggQuery != NULL){
+
+						aggStruct * agg = (aggStruct *)malloc(sizeof(aggStruct));
+						char * table = (char *)malloc(AGG_MAX_GROUPS*160);
+
+						if(agg == NULL || table == NULL){
+
+							throwError(3,__LINE__);
+
+						}else if(!aggParseQuery(options.aggQuery,agg) || aggregateList(head,agg) < 0){
+
+							throwError(6,__LINE__);
+
+						}else{
+
+							aggFormat(agg,table,AGG_MAX_GROUPS*160);
+							VPRINTF(VERB_QUIET,"\n%s",table); // asked for explicitly, so printed even with -q
+						}
+
+						free(agg);
+						free(table);
+					}
+
+					if(options.rangeFlag){
+
+						printRange(options.rangeLo,options.rangeHi,options.rangeLimit);
+					}
+					
 					searchList(head,24,1); // Flag 1 returns 1 if found.. any value except 1 returns the index/position
 					searchList(head,243,1);
 
@@ -952,7 +5490,7 @@ int main(int argc, char *argv[]){
 					
 				
 					printList(head,1);
-					netLog();
+					netLog(head);
 					//readLog();	
 					//netLog();
 
@@ -982,7 +5520,7 @@ int main(int argc, char *argv[]){
 						scanf(" %c",&userAns2);
 						if(userAns2 == 'y' || userAns2 == 'Y'){
 
-							i = overwriteFile(&head,argv[1]);
+							i = options.compact ? overwriteFile(&head,dataFile) : saveChanges(&head,dataFile);
 
 							if(i == 0){
 
@@ -1020,11 +5558,13 @@ int main(int argc, char *argv[]){
 		free(head);
 		
 
-		atexit(done);
-
 		end = clock();
 
-		printf("\nRun Time : %.2f",(float)(end-begin)/CLOCKS_PER_SEC);
+		VPRINTF(VERB_NORMAL,"\nRun Time : %.2f",(float)(end-begin)/CLOCKS_PER_SEC);
+
+		if(options.traceFile != NULL){
+			traceExport(options.traceFile);
+		}
 
 
 		return 0;
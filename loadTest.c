@@ -0,0 +1,570 @@
+/*
+*******************************************
+* Program Name  : loadTest.c              *
+* Author		: Sandesh Sharma.         *
+*******************************************
+*/
+// Program Description
+// ------------------------------------------------------------------------
+// | Load generator for the empManagement log server (localhost:8080).   |
+// | Keeps n connections busy with a weighted mix of requests (the log    |
+// | listing and /agg queries) and reports throughput, p50/p99/p999       |
+// | latency and errors, overall and per request. -get fetches one page   |
+// | and prints it, in place of pointing a browser at the server.         |
+// ------------------------------------------------------------------------
+// Run the server with -serve so it takes more than one client :
+//   ./empManagement empInfo.bin -q -serve 30      then      ./loadTest -c 32 -d 20
+
+
+#if defined(_WIN32)
+#error loadTest uses POSIX sockets and threads, build it on Linux
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+
+#define LOAD_MAX_CONN 1024
+#define LOAD_MAX_MIX 16
+#define LOAD_PATH_MAX 256
+
+// Latency histogram in microseconds : exact below HIST_SUB, then HIST_SUB/2 buckets per
+// power of two (about 1.5% wide), up to 2^35 us (past any timeout). Small enough to keep
+// one per thread and mix entry.
+#define HIST_SUB 128
+#define HIST_SHIFTS 28
+#define HIST_BUCKETS (HIST_SUB + HIST_SHIFTS*(HIST_SUB/2))
+
+#define ERR_CONNECT 0
+#define ERR_SEND 1
+#define ERR_RECV 2 // reset, timed out or closed before a status line
+#define ERR_STATUS 3 // anything but 2xx
+#define ERR_KINDS 4
+
+
+typedef struct mixStruct{
+
+	char path[LOAD_PATH_MAX];
+	int weight;
+
+}mixStruct;
+
+typedef struct histStruct{
+
+	long long counts[HIST_BUCKETS];
+	long long total;
+	long long maxUs;
+
+}histStruct;
+
+typedef struct workerStruct{
+
+	int id;
+	unsigned int seed;
+	histStruct * hist; // one per mix entry, merged for the totals
+	long long errors[ERR_KINDS];
+	long long bytes;
+	pthread_t tid;
+
+}workerStruct;
+
+typedef struct loadStruct{ // set up by main, read only while the workers run
+
+	struct sockaddr_storage addr;
+	socklen_t addrLen;
+	const char * host;
+	mixStruct mix[LOAD_MAX_MIX];
+	int mixCount;
+	int weightTotal;
+	int timeoutMs;
+	long long warmEnd; // us, samples before this aren't kept
+	long long stopAt; // us, 0 : run until quota requests are done
+	long quota;
+	volatile long issued; // requests started, for -n
+
+}loadStruct;
+
+
+static loadStruct load;
+
+
+static int argToInt(const char * s, int * out); // Strict string to int, returns 1 on success.
+static bool parseMix(const char * spec); // "w:path,w:path..." into load.mix, false on a bad spec.
+static long long nowUs(); // Monotonic clock in microseconds.
+static int histIndex(long long us); // Bucket of a latency.
+static long long histValue(int idx); // Middle of a bucket.
+static void histAdd(histStruct * h, long long us);
+static void histMerge(histStruct * into, const histStruct * from);
+static long long histPercentile(const histStruct * h, double p); // Latency at fraction p of the samples.
+static int fetch(const char * path, FILE * body, long long * bytes); // One request on a fresh connection, ERR_* or -1 on success.
+static void * worker(void * arg); // Closed loop : one request at a time until the run ends.
+static void report(const char * label, const histStruct * h, double secs); // One line of percentiles.
+static void usage(const char * prog); // Prints the options.
+
+
+
+static int argToInt(const char * s, int * out){
+
+	int retFlag = 0;
+	char * end = NULL;
+	long v;
+
+	if(s != NULL && *s != '\0'){
+
+		v = strtol(s,&end,10);
+		if(*end == '\0' && v >= -2147483647L - 1 && v <= 2147483647L){
+			*out = (int)v;
+			retFlag = 1;
+		}
+	}
+
+	return retFlag;
+}
+
+
+static bool parseMix(const char * spec){
+
+	const char * p = spec;
+	const char * colon;
+	const char * comma;
+	int len;
+
+	load.mixCount = 0;
+	load.weightTotal = 0;
+
+	while(*p != '\0'){
+
+		comma = strchr(p,',');
+		if(comma == NULL){
+			comma = p + strlen(p);
+		}
+		colon = memchr(p,':',comma-p);
+		if(colon == NULL || load.mixCount == LOAD_MAX_MIX){
+			return false;
+		}
+
+		load.mix[load.mixCount].weight = atoi(p);
+		len = (int)(comma - colon - 1);
+		if(load.mix[load.mixCount].weight <= 0 || len <= 0 || len >= LOAD_PATH_MAX || colon[1] != '/'){
+			return false;
+		}
+		memcpy(load.mix[load.mixCount].path,colon+1,len);
+		load.mix[load.mixCount].path[len] = '\0';
+		load.weightTotal += load.mix[load.mixCount].weight;
+		load.mixCount++;
+
+		p = (*comma == ',') ? comma+1 : comma;
+	}
+
+	return load.mixCount > 0;
+}
+
+
+static long long nowUs(){
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+
+static int histIndex(long long us){
+
+	int shift = 0;
+
+	if(us < 0){
+		us = 0;
+	}
+	if(us < HIST_SUB){
+		return (int)us;
+	}
+	while((us >> shift) >= HIST_SUB && shift < HIST_SHIFTS){
+		shift++;
+	}
+	// (us >> shift) is in [HIST_SUB/2, HIST_SUB) now
+	return HIST_SUB + (shift-1)*(HIST_SUB/2) + (int)((us >> shift) - HIST_SUB/2);
+}
+
+
+static long long histValue(int idx){
+
+	int shift;
+	long long sub;
+
+	if(idx < HIST_SUB){
+		return idx;
+	}
+	shift = (idx - HIST_SUB) / (HIST_SUB/2) + 1;
+	sub = (idx - HIST_SUB) % (HIST_SUB/2) + HIST_SUB/2;
+
+	return (sub << shift) + (1LL << (shift-1));
+}
+
+
+static void histAdd(histStruct * h, long long us){
+
+	int idx = histIndex(us);
+
+	h->counts[idx < HIST_BUCKETS ? idx : HIST_BUCKETS-1]++;
+	h->total++;
+	if(us > h->maxUs){
+		h->maxUs = us;
+	}
+}
+
+
+static void histMerge(histStruct * into, const histStruct * from){
+
+	int i;
+
+	for(i = 0; i < HIST_BUCKETS; i++){
+		into->counts[i] += from->counts[i];
+	}
+	into->total += from->total;
+	if(from->maxUs > into->maxUs){
+		into->maxUs = from->maxUs;
+	}
+}
+
+
+static long long histPercentile(const histStruct * h, double p){
+
+	long long want = (long long)(p * h->total),seen = 0;
+	int i;
+
+	if(want >= h->total){
+		want = h->total - 1;
+	}
+	for(i = 0; i < HIST_BUCKETS; i++){
+
+		seen += h->counts[i];
+		if(seen > want){
+			break;
+		}
+	}
+
+	return (i < HIST_BUCKETS && histValue(i) < h->maxUs) ? histValue(i) : h->maxUs;
+}
+
+
+static int fetch(const char * path, FILE * body, long long * bytes){
+
+	char buf[16384];
+	char req[LOAD_PATH_MAX + 128];
+	struct timeval tv;
+	int sock,len,sent,got,status = 0,one = 1;
+	int retFlag = -1;
+	long long total = 0;
+
+	sock = socket(load.addr.ss_family,SOCK_STREAM,0);
+	if(sock < 0){
+		return ERR_CONNECT;
+	}
+
+	tv.tv_sec = load.timeoutMs / 1000;
+	tv.tv_usec = (load.timeoutMs % 1000) * 1000;
+	setsockopt(sock,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+	setsockopt(sock,SOL_SOCKET,SO_SNDTIMEO,&tv,sizeof(tv));
+	setsockopt(sock,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+
+	if(connect(sock,(struct sockaddr *)&load.addr,load.addrLen) != 0){
+
+		close(sock);
+		return ERR_CONNECT;
+	}
+
+	len = snprintf(req,sizeof(req),"GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n",path,load.host);
+	for(sent = 0; sent < len; sent += got){
+
+		got = send(sock,req+sent,len-sent,MSG_NOSIGNAL);
+		if(got <= 0){
+
+			close(sock);
+			return ERR_SEND;
+		}
+	}
+
+	// The server closes after the response, so the end of the stream is the end of it.
+	while((got = recv(sock,buf,sizeof(buf),0)) > 0){
+
+		if(total == 0 && got >= 12 && strncmp(buf,"HTTP/1.",7) == 0){
+			status = atoi(buf+9);
+		}
+		if(body != NULL){
+			fwrite(buf,1,got,body);
+		}
+		total += got;
+	}
+
+	if(got < 0 || status == 0){
+		retFlag = ERR_RECV;
+	}else if(status < 200 || status > 299){
+		retFlag = ERR_STATUS;
+	}
+
+	close(sock);
+	*bytes += total;
+	return retFlag;
+}
+
+
+static void * worker(void * arg){
+
+	workerStruct * w = (workerStruct *)arg;
+	long long start,end;
+	int pick,m,err;
+
+	for(;;){
+
+		if(load.stopAt > 0){
+
+			if(nowUs() >= load.stopAt){
+				break;
+			}
+
+		}else if(__sync_fetch_and_add(&load.issued,1) >= load.quota){
+			break;
+		}
+
+		pick = rand_r(&w->seed) % load.weightTotal; // weighted pick from the mix
+		for(m = 0; pick >= load.mix[m].weight; m++){
+			pick -= load.mix[m].weight;
+		}
+
+		start = nowUs();
+		err = fetch(load.mix[m].path,NULL,&w->bytes);
+		end = nowUs();
+
+		if(start < load.warmEnd){
+			continue;
+		}
+		if(err >= 0){
+			w->errors[err]++;
+		}else{
+			histAdd(&w->hist[m],end-start);
+		}
+		if(err == ERR_CONNECT){
+			usleep(1000); // server gone or queue full, don't spin
+		}
+	}
+
+	return NULL;
+}
+
+
+static void report(const char * label, const histStruct * h, double secs){
+
+	if(h->total == 0){
+
+		printf("%-40s : no successful requests\n",label);
+		return;
+	}
+
+	printf("%-40s : %9lld ok %10.1f req/s   p50 %8.3f  p99 %8.3f  p999 %8.3f  max %8.3f ms\n",label,h->total,h->total/secs,
+		histPercentile(h,0.50)/1000.0,histPercentile(h,0.99)/1000.0,histPercentile(h,0.999)/1000.0,h->maxUs/1000.0);
+}
+
+
+static void usage(const char * prog){
+
+	printf("\nusage : %s [-host 127.0.0.1] [-port 8080] [-c conns] [-d secs | -n requests] [-warmup secs] [-mix spec] [-timeout ms] [-seed n] [-get path]\n",prog);
+	printf("\n-c n         : connections kept busy at once (a thread each), default 16, at most %d",LOAD_MAX_CONN);
+	printf("\n-d secs      : how long to measure, default 10");
+	printf("\n-n requests  : send this many requests instead of running for a time");
+	printf("\n-warmup secs : run this long first without keeping the samples, default 1 (0 with -n)");
+	printf("\n-mix spec    : weighted requests, weight:path,... default 1:/,2:/agg?group=age&field=age,1:/agg?group=domain&field=phone");
+	printf("\n-timeout ms  : per send/receive, a request past it counts as an error, default 5000");
+	printf("\n-seed n      : seeds the picks from the mix so a run can be repeated, default 1");
+	printf("\n-get path    : fetch path once, print the response and exit\n");
+}
+
+
+int main(int argc, char * argv[]){
+
+	int retFlag = 0,i,m,k,conns = 16,secs = 10,warmup = -1,seed = 1,quota = 0;
+	const char * host = "127.0.0.1";
+	const char * port = "8080";
+	const char * mixSpec = "1:/,2:/agg?group=age&field=age,1:/agg?group=domain&field=phone";
+	const char * getPath = NULL;
+	struct addrinfo hints;
+	struct addrinfo * res;
+	workerStruct * workers;
+	histStruct * all;
+	histStruct * entry;
+	long long errors[ERR_KINDS] = {0},bytes = 0,errTotal,began,ended;
+	double elapsed;
+	char label[LOAD_PATH_MAX + 8];
+
+
+	load.timeoutMs = 5000;
+
+	for(i = 1; i < argc; i++){
+
+		if(strcmp(argv[i],"-host") == 0 && i+1 < argc){
+			host = argv[++i];
+		}else if(strcmp(argv[i],"-port") == 0 && i+1 < argc){
+			port = argv[++i];
+		}else if(strcmp(argv[i],"-c") == 0 && i+1 < argc && argToInt(argv[i+1],&conns) && conns > 0 && conns <= LOAD_MAX_CONN){
+			i++;
+		}else if(strcmp(argv[i],"-d") == 0 && i+1 < argc && argToInt(argv[i+1],&secs) && secs > 0){
+			i++;
+		}else if(strcmp(argv[i],"-n") == 0 && i+1 < argc && argToInt(argv[i+1],&quota) && quota > 0){
+			i++;
+		}else if(strcmp(argv[i],"-warmup") == 0 && i+1 < argc && argToInt(argv[i+1],&warmup) && warmup >= 0){
+			i++;
+		}else if(strcmp(argv[i],"-mix") == 0 && i+1 < argc){
+			mixSpec = argv[++i];
+		}else if(strcmp(argv[i],"-timeout") == 0 && i+1 < argc && argToInt(argv[i+1],&load.timeoutMs) && load.timeoutMs > 0){
+			i++;
+		}else if(strcmp(argv[i],"-seed") == 0 && i+1 < argc && argToInt(argv[i+1],&seed)){
+			i++;
+		}else if(strcmp(argv[i],"-get") == 0 && i+1 < argc && argv[i+1][0] == '/'){
+			getPath = argv[++i];
+		}else{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(!parseMix(mixSpec)){
+
+		fprintf(stderr,"\nbad -mix, expected weight:path,... e.g. 3:/,1:/agg?group=age\n");
+		return 1;
+	}
+
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if(getaddrinfo(host,port,&hints,&res) != 0 || res == NULL){
+
+		fprintf(stderr,"\n%s:%s could not be resolved\n",host,port);
+		return 1;
+	}
+	memcpy(&load.addr,res->ai_addr,res->ai_addrlen);
+	load.addrLen = res->ai_addrlen;
+	load.host = host;
+	freeaddrinfo(res);
+
+
+	if(getPath != NULL){ // stand-in for the browser
+
+		retFlag = fetch(getPath,stdout,&bytes);
+		if(retFlag >= 0){
+			fprintf(stderr,"\nrequest failed (%s)\n",retFlag == ERR_CONNECT ? "connect" : (retFlag == ERR_SEND ? "send" : (retFlag == ERR_RECV ? "receive" : "status")));
+		}
+		return retFlag >= 0 ? 1 : 0;
+	}
+
+
+	if(warmup < 0){
+		warmup = (quota > 0) ? 0 : 1;
+	}
+
+	workers = (workerStruct *)calloc(conns,sizeof(workerStruct));
+	all = (histStruct *)calloc(1,sizeof(histStruct));
+	entry = (histStruct *)calloc(1,sizeof(histStruct));
+	if(workers == NULL || all == NULL || entry == NULL){
+
+		fprintf(stderr,"\nout of memory\n");
+		free(workers);
+		free(all);
+		free(entry);
+		return 1;
+	}
+
+	began = nowUs();
+	load.warmEnd = began + warmup*1000000LL;
+	load.stopAt = (quota > 0) ? 0 : load.warmEnd + secs*1000000LL;
+	load.quota = quota;
+
+	printf("\nTarget : %s:%s, %d connections, ",host,port,conns);
+	if(quota > 0){
+		printf("%d requests",quota);
+	}else{
+		printf("%d s",secs);
+	}
+	printf(" (%d s warmup), seed %d\n",warmup,seed);
+
+	for(k = 0; k < conns; k++){
+
+		workers[k].hist = (histStruct *)calloc(load.mixCount,sizeof(histStruct));
+		if(workers[k].hist == NULL){
+
+			fprintf(stderr,"\nout of memory, only %d connections started\n",k);
+			conns = k;
+			break;
+		}
+		workers[k].id = k;
+		workers[k].seed = (unsigned int)seed * 2654435761u + (unsigned int)k;
+		if(pthread_create(&workers[k].tid,NULL,worker,&workers[k]) != 0){
+
+			fprintf(stderr,"\nonly %d connections could be started\n",k);
+			free(workers[k].hist); // the ones after k were never allocated
+			workers[k].hist = NULL;
+			conns = k;
+			break;
+		}
+	}
+
+	for(k = 0; k < conns; k++){
+		pthread_join(workers[k].tid,NULL);
+	}
+	ended = nowUs();
+
+	elapsed = (ended - (load.warmEnd > ended ? ended : load.warmEnd)) / 1e6;
+	if(elapsed <= 0){
+		elapsed = 1e-6;
+	}
+
+	for(k = 0; k < conns; k++){
+
+		for(m = 0; m < load.mixCount; m++){
+			histMerge(all,&workers[k].hist[m]);
+		}
+		for(i = 0; i < ERR_KINDS; i++){
+			errors[i] += workers[k].errors[i];
+		}
+		bytes += workers[k].bytes;
+	}
+	errTotal = errors[ERR_CONNECT] + errors[ERR_SEND] + errors[ERR_RECV] + errors[ERR_STATUS];
+
+	printf("\nMeasured %.2f s : %lld ok, %lld errors (connect %lld, send %lld, receive %lld, status %lld)\n",elapsed,all->total,errTotal,
+		errors[ERR_CONNECT],errors[ERR_SEND],errors[ERR_RECV],errors[ERR_STATUS]);
+	printf("Received %.2f MB/s (warmup included)\n\n",bytes / 1048576.0 / ((ended - began) / 1e6));
+
+	report("all",all,elapsed);
+	for(m = 0; m < load.mixCount; m++){
+
+		memset(entry,0,sizeof(histStruct));
+		for(k = 0; k < conns; k++){
+			histMerge(entry,&workers[k].hist[m]);
+		}
+		snprintf(label,sizeof(label),"  %s",load.mix[m].path);
+		report(label,entry,elapsed);
+	}
+	printf("\n");
+
+	for(k = 0; k < conns; k++){
+		free(workers[k].hist);
+	}
+	free(workers);
+	free(all);
+	free(entry);
+
+	return errTotal > 0 ? 2 : retFlag;
+}
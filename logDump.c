@@ -0,0 +1,464 @@
+
+/*
+*******************************************
+* Program Name  : logDump.c               *
+* Author		: Sandesh Sharma.         *
+*******************************************
+*/
+// Program Description
+// ------------------------------------------------------------------------
+// | Dumps (replays) the error log written by empManagement (log.bin)     |
+// | as text, without going through the TCP server. Meant for big logs:   |
+// | the file is mapped instead of read record by record, formatted in    |
+// | parallel chunks and written out in a few large writes.               |
+// ------------------------------------------------------------------------
+
+
+#if defined(_WIN32) // If on Windows enviroment
+#include <windows.h>
+#else // Linux/UNIX enviroment
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "errLog.h"
+
+
+#define DUMP_WINDOW 65536 // records one thread formats before the output is flushed
+#define DUMP_MAX_THREADS 16
+#define DUMP_LINE_MAX (sizeof(((errStruct*)0)->errMessage) + 96) // longest line one record can make
+
+
+typedef struct filterStruct{
+
+	const char * grep; // substring of the message, NULL for any
+	bool valueFlag;
+	int value; // only records carrying this associated value
+	int from; // yyyymmdd, 0 for no lower bound
+	int to; // yyyymmdd, 0 for no upper bound
+	bool plain; // message and value only, like the network log
+
+}filterStruct;
+
+typedef struct chunkStruct{
+
+	const errStruct * recs;
+	size_t count;
+	const filterStruct * filter;
+	char * buf; // DUMP_WINDOW * DUMP_LINE_MAX bytes
+	size_t len; // bytes formatted into buf
+	size_t matched;
+
+}chunkStruct;
+
+
+static int argToInt(const char * s, int * out); // Strict string to int, returns 1 on success.
+static int parseDate(const char * s, int * out); // "YYYY-MM-DD" to yyyymmdd, returns 1 on success.
+static char * appendInt(char * p, int v); // Writes v in decimal at p, returns the end.
+static bool recordMatches(const errStruct * r, const filterStruct * f); // Applies the filters to one record.
+static void formatChunk(chunkStruct * c); // Formats the matching records of a chunk into its buffer.
+static const errStruct * mapLog(const char * fileName, size_t * count, void ** handle); // Maps the log read only.
+static void unmapLog(const errStruct * recs, size_t count, void * handle); // Undoes mapLog.
+static void usage(const char * prog); // Prints the options.
+
+
+
+static int argToInt(const char * s, int * out){
+
+	int retFlag = 0;
+	char * end = NULL;
+	long v;
+
+	if(s != NULL && *s != '\0'){
+
+		v = strtol(s,&end,10);
+		if(*end == '\0' && v >= -2147483647L - 1 && v <= 2147483647L){
+			*out = (int)v;
+			retFlag = 1;
+		}
+	}
+
+	return retFlag;
+}
+
+static int parseDate(const char * s, int * out){
+
+	int retFlag = 0,y,m,d;
+	char tail;
+
+	if(s != NULL && sscanf(s,"%d-%d-%d%c",&y,&m,&d,&tail) == 3 && m >= 1 && m <= 12 && d >= 1 && d <= 31){
+		*out = y*10000 + m*100 + d;
+		retFlag = 1;
+	}
+
+	return retFlag;
+}
+
+
+static char * appendInt(char * p, int v){
+
+	char tmp[12];
+	int n = 0;
+	unsigned int u = v < 0 ? 0u - (unsigned int)v : (unsigned int)v;
+
+	if(v < 0){
+		*p++ = '-';
+	}
+
+	do{
+		tmp[n++] = (char)('0' + u % 10);
+		u /= 10;
+	}while(u != 0);
+
+	while(n > 0){
+		*p++ = tmp[--n];
+	}
+
+	return p;
+}
+
+
+static bool recordMatches(const errStruct * r, const filterStruct * f){
+
+	int date;
+	char msg[sizeof(r->errMessage) + 1];
+
+	if(f->valueFlag && (!r->valAssocFlag || r->valueAssoc != f->value)){
+		return false;
+	}
+
+	if(f->from != 0 || f->to != 0){
+
+		date = r->errYear*10000 + r->errMonth*100 + r->errDoM;
+		if((f->from != 0 && date < f->from) || (f->to != 0 && date > f->to)){
+			return false;
+		}
+	}
+
+	if(f->grep != NULL){
+
+		// errMessage is only NUL terminated if the message was shorter than the field
+		memcpy(msg,r->errMessage,sizeof(r->errMessage));
+		msg[sizeof(r->errMessage)] = '\0';
+		if(strstr(msg,f->grep) == NULL){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Same text printErrLog() prints, one record per line. Hand rolled instead of
+// snprintf because this is the whole cost of a dump once the file is mapped.
+static void formatChunk(chunkStruct * c){
+
+	size_t i,n;
+	const errStruct * r;
+	char * p = c->buf;
+
+	c->matched = 0;
+
+	for(i = 0; i < c->count; i++){
+
+		r = &c->recs[i];
+		if(!recordMatches(r,c->filter)){
+			continue;
+		}
+
+		if(!c->filter->plain){
+
+			memcpy(p,"[ERR LOG] [ ",12); p += 12;
+			p = appendInt(p,r->errDoM); *p++ = '/';
+			p = appendInt(p,r->errMonth); *p++ = '/';
+			p = appendInt(p,r->errYear); *p++ = ' '; *p++ = ' ';
+			p = appendInt(p,r->errToD); *p++ = ':';
+			p = appendInt(p,r->errM); *p++ = ':';
+			p = appendInt(p,r->errS);
+			memcpy(p," ] ",3); p += 3;
+		}
+
+		for(n = 0; n < sizeof(r->errMessage) && r->errMessage[n] != '\0'; n++){
+			;
+		}
+		memcpy(p,r->errMessage,n); p += n;
+
+		if(r->valAssocFlag){
+
+			if(!c->filter->plain){
+				*p++ = ' ';
+			}
+			p = appendInt(p,r->valueAssoc);
+		}
+
+		*p++ = '\n';
+		c->matched++;
+	}
+
+	c->len = (size_t)(p - c->buf);
+}
+
+
+#if defined(_WIN32)
+
+static const errStruct * mapLog(const char * fileName, size_t * count, void ** handle){
+
+	const errStruct * retPtr = NULL;
+	HANDLE file,map;
+	LARGE_INTEGER size;
+
+	*count = 0;
+	*handle = NULL;
+
+	file = CreateFileA(fileName,GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		return NULL;
+	}
+
+	if(GetFileSizeEx(file,&size) && size.QuadPart >= (LONGLONG)sizeof(errStruct)){
+
+		map = CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+		if(map != NULL){
+
+			retPtr = (const errStruct*)MapViewOfFile(map,FILE_MAP_READ,0,0,0);
+			if(retPtr != NULL){
+				*count = (size_t)(size.QuadPart / sizeof(errStruct));
+				*handle = map;
+			}else{
+				CloseHandle(map);
+			}
+		}
+	}
+
+	CloseHandle(file); // the mapping keeps the file open
+	return retPtr;
+}
+
+static void unmapLog(const errStruct * recs, size_t count, void * handle){
+
+	(void)count;
+	if(recs != NULL){
+		UnmapViewOfFile(recs);
+		CloseHandle((HANDLE)handle);
+	}
+}
+
+#else
+
+static const errStruct * mapLog(const char * fileName, size_t * count, void ** handle){
+
+	const errStruct * retPtr = NULL;
+	struct stat st;
+	void * p;
+	int fd;
+
+	*count = 0;
+	*handle = NULL;
+
+	fd = open(fileName,O_RDONLY);
+	if(fd < 0){
+		return NULL;
+	}
+
+	if(fstat(fd,&st) == 0 && st.st_size >= (off_t)sizeof(errStruct)){
+
+		p = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+		if(p != MAP_FAILED){
+
+			madvise(p,(size_t)st.st_size,MADV_SEQUENTIAL);
+			retPtr = (const errStruct*)p;
+			*count = (size_t)st.st_size / sizeof(errStruct); // a torn record at the end is ignored
+		}
+	}
+
+	close(fd); // the mapping keeps the file open
+	return retPtr;
+}
+
+static void unmapLog(const errStruct * recs, size_t count, void * handle){
+
+	(void)handle;
+	if(recs != NULL){
+		munmap((void*)recs,count * sizeof(errStruct));
+	}
+}
+
+static void * formatThread(void * arg){
+
+	formatChunk((chunkStruct*)arg);
+	return NULL;
+}
+
+#endif
+
+
+static void usage(const char * prog){
+
+	printf("\nusage : %s [-f log.bin] [-o out.txt] [-grep text] [-value n] [-from YYYY-MM-DD] [-to YYYY-MM-DD] [-threads n] [-plain] [-count]\n",prog);
+	printf("\n-f file      : log to read, default log.bin");
+	printf("\n-o file      : write the text there instead of stdout");
+	printf("\n-grep text   : only messages containing text");
+	printf("\n-value n     : only records carrying the value n (ids, counts)");
+	printf("\n-from/-to    : only records logged on or after / on or before that date");
+	printf("\n-threads n   : formatting threads, default 4");
+	printf("\n-plain       : message and value only, as served on localhost:8080");
+	printf("\n-count       : print how many records matched instead of the records\n");
+}
+
+
+int main(int argc, char * argv[]){
+
+	int retFlag = 0,i,t,threads = 4,used;
+	bool countOnly = false;
+	const char * inName = "log.bin";
+	const char * outName = NULL;
+	filterStruct filter = {NULL,false,0,0,0,false};
+	chunkStruct chunks[DUMP_MAX_THREADS];
+	const errStruct * recs;
+	size_t count,done = 0,matched = 0;
+	void * handle;
+	FILE * out = stdout;
+#if !defined(_WIN32)
+	pthread_t tids[DUMP_MAX_THREADS];
+#endif
+
+
+	for(i = 1; i < argc; i++){
+
+		if(strcmp(argv[i],"-f") == 0 && i+1 < argc){
+			inName = argv[++i];
+		}else if(strcmp(argv[i],"-o") == 0 && i+1 < argc){
+			outName = argv[++i];
+		}else if(strcmp(argv[i],"-grep") == 0 && i+1 < argc){
+			filter.grep = argv[++i];
+		}else if(strcmp(argv[i],"-value") == 0 && i+1 < argc && argToInt(argv[i+1],&filter.value)){
+			filter.valueFlag = true;
+			i++;
+		}else if(strcmp(argv[i],"-from") == 0 && i+1 < argc && parseDate(argv[i+1],&filter.from)){
+			i++;
+		}else if(strcmp(argv[i],"-to") == 0 && i+1 < argc && parseDate(argv[i+1],&filter.to)){
+			i++;
+		}else if(strcmp(argv[i],"-threads") == 0 && i+1 < argc && argToInt(argv[i+1],&threads) && threads > 0){
+			i++;
+		}else if(strcmp(argv[i],"-plain") == 0){
+			filter.plain = true;
+		}else if(strcmp(argv[i],"-count") == 0){
+			countOnly = true;
+		}else{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(threads > DUMP_MAX_THREADS){
+		threads = DUMP_MAX_THREADS;
+	}
+#if defined(_WIN32)
+	threads = 1; // chunks are still formatted into one big buffer, just not in parallel
+#endif
+
+
+	recs = mapLog(inName,&count,&handle);
+	if(recs == NULL){
+		fprintf(stderr,"\n%s is empty or could not be opened\n",inName);
+		return 1;
+	}
+
+	if(outName != NULL){
+
+		out = fopen(outName,"wb");
+		if(out == NULL){
+			fprintf(stderr,"\n%s could not be opened for writing\n",outName);
+			unmapLog(recs,count,handle);
+			return 1;
+		}
+	}
+
+	for(t = 0; t < threads; t++){
+
+		chunks[t].filter = &filter;
+		chunks[t].buf = (char*)malloc(DUMP_WINDOW * DUMP_LINE_MAX);
+		if(chunks[t].buf == NULL){
+			threads = t;
+			break;
+		}
+	}
+
+	if(threads == 0){
+		fprintf(stderr,"\nout of memory\n");
+		retFlag = 1;
+	}
+
+
+	// One round hands every thread a window of the mapping, then the buffers
+	// are written in file order so the output matches a sequential dump.
+	while(retFlag == 0 && done < count){
+
+		used = 0;
+		for(t = 0; t < threads && done < count; t++){
+
+			chunks[t].recs = recs + done;
+			chunks[t].count = count - done < DUMP_WINDOW ? count - done : DUMP_WINDOW;
+			done += chunks[t].count;
+			used++;
+		}
+
+#if defined(_WIN32)
+		formatChunk(&chunks[0]);
+#else
+		if(used == 1){
+			formatChunk(&chunks[0]);
+		}else{
+
+			for(t = 0; t < used; t++){
+
+				if(pthread_create(&tids[t],NULL,formatThread,&chunks[t]) != 0){
+					tids[t] = pthread_self(); // mark it, format it on this thread instead
+					formatChunk(&chunks[t]);
+				}
+			}
+
+			for(t = 0; t < used; t++){
+
+				if(!pthread_equal(tids[t],pthread_self())){
+					pthread_join(tids[t],NULL);
+				}
+			}
+		}
+#endif
+
+		for(t = 0; t < used; t++){
+
+			matched += chunks[t].matched;
+			if(!countOnly && chunks[t].len > 0 && fwrite(chunks[t].buf,1,chunks[t].len,out) != chunks[t].len){
+				fprintf(stderr,"\nwrite failed\n");
+				retFlag = 1;
+				break;
+			}
+		}
+	}
+
+	if(countOnly){
+		fprintf(out,"%lu of %lu records matched\n",(unsigned long)matched,(unsigned long)count);
+	}
+
+	for(t = 0; t < threads; t++){
+		free(chunks[t].buf);
+	}
+
+	if(out != stdout && fclose(out) != 0){
+		retFlag = 1;
+	}
+
+	unmapLog(recs,count,handle);
+
+	return retFlag;
+}